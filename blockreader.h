@@ -0,0 +1,354 @@
+// Copyright (c) Len Popp
+// This source code is licensed under the MIT license - see LICENSE file.
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+// A minimal io_uring for reads, using the system calls directly so that
+// liburing isn't needed. Each read has a tag to tell which one finished.
+class UringReader
+{
+private:
+    int ringFd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    void* sqesMem = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+    io_uring_params params{};
+
+    template<class T>
+    T* at(void* ring, uint32_t offset) const
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+    }
+
+public:
+    UringReader(const UringReader&) = delete;
+    UringReader& operator=(const UringReader&) = delete;
+
+    // Set up a ring for up to the given number of reads in flight.
+    explicit UringReader(unsigned entries)
+    {
+        ringFd = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (ringFd < 0) {
+            return;
+        }
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd, IORING_OFF_SQ_RING);
+        cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqRing
+            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ringFd, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqesMem = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd, IORING_OFF_SQES);
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqesMem == MAP_FAILED) {
+            close(ringFd);
+            ringFd = -1;
+        }
+    }
+
+    ~UringReader()
+    {
+        if (sqesMem != MAP_FAILED) {
+            munmap(sqesMem, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (ringFd >= 0) {
+            close(ringFd);
+        }
+    }
+
+    // Is io_uring available? (It's often disabled, e.g. in containers.)
+    bool ok() const
+    {
+        return ringFd >= 0;
+    }
+
+    // Start reading into a buffer from a file at an offset.
+    // Return false if the read couldn't be started.
+    bool submit(int fd, std::span<char> buffer, uint64_t offset, uint64_t tag)
+    {
+        std::atomic_ref<uint32_t> tail(*at<uint32_t>(sqRing, params.sq_off.tail));
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t index = t & *at<uint32_t>(sqRing, params.sq_off.ring_mask);
+        io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqesMem)[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer.data());
+        sqe.len = uint32_t(buffer.size());
+        sqe.off = offset;
+        sqe.user_data = tag;
+        at<uint32_t>(sqRing, params.sq_off.array)[index] = index;
+        tail.store(t + 1, std::memory_order_release);
+        return syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, nullptr, 0) == 1;
+    }
+
+    // Tag returned by wait() if it fails
+    static constexpr uint64_t noTag = ~uint64_t(0);
+
+    // Wait for a read to finish and return its tag and its result: the number
+    // of bytes read, or a negative error number.
+    std::pair<uint64_t, int> wait()
+    {
+        std::atomic_ref<uint32_t> head(*at<uint32_t>(cqRing, params.cq_off.head));
+        std::atomic_ref<uint32_t> tail(*at<uint32_t>(cqRing, params.cq_off.tail));
+        uint32_t h = head.load(std::memory_order_relaxed);
+        while (tail.load(std::memory_order_acquire) == h) {
+            if (syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS,
+                nullptr, 0) < 0 && errno != EINTR)
+            {
+                return { noTag, -errno };
+            }
+        }
+        uint32_t index = h & *at<uint32_t>(cqRing, params.cq_off.ring_mask);
+        const io_uring_cqe& cqe = at<io_uring_cqe>(cqRing, params.cq_off.cqes)[index];
+        std::pair<uint64_t, int> result{ cqe.user_data, cqe.res };
+        head.store(h + 1, std::memory_order_release);
+        return result;
+    }
+};
+#endif
+
+// Reads a file, or stdin, a block at a time, so that a big file can be parsed
+// without holding all of it in memory.
+// On Linux, a regular file is read with io_uring, which keeps reads of the
+// next few blocks in flight while the caller works on the current one. Other
+// files (e.g. pipes), other systems, and systems without io_uring use
+// ordinary reads.
+// Errors throw std::runtime_error.
+class BlockReader
+{
+public:
+    static constexpr size_t blockSize = 1 << 20;
+    // Number of blocks read ahead with io_uring, plus the current one
+    static constexpr unsigned numBuffers = 4;
+
+private:
+    std::string name;
+    std::array<std::unique_ptr<char[]>, numBuffers> buffers;
+    unsigned current = 0;   // the buffer for the block next() returns next
+#ifdef __linux__
+    int fd = -1;
+    bool fOwnFd = false;
+    std::unique_ptr<UringReader> uring;
+    // The io_uring reads are queued in the buffers from current on, in order.
+    unsigned numQueued = 0;     // reads queued, whether finished or not
+    unsigned numInFlight = 0;   // reads not finished yet
+    bool fReturned = false;     // current holds the block returned last time
+    bool fEnd = false;          // a read reached the end of the file
+    uint64_t offset = 0;        // where the next io_uring read starts
+    std::array<uint64_t, numBuffers> offsets{};   // where each buffer's read starts
+    std::array<std::optional<int>, numBuffers> results; // finished reads' results
+#else
+    std::ifstream inFile;
+    std::istream* input = &std::cin;
+#endif
+
+    [[noreturn]] void throwReadError() const
+    {
+        throw std::runtime_error(std::format("Failed to read file {}", name));
+    }
+
+#ifdef __linux__
+    // Queue reads into the free buffers, after the ones already queued.
+    void fill()
+    {
+        while (!fEnd && numQueued < numBuffers) {
+            unsigned slot = (current + numQueued) % numBuffers;
+            if (!uring->submit(fd, { buffers[slot].get(), blockSize }, offset, slot)) {
+                // Try again next time, or carry on with ordinary reads if
+                // there's nothing left in the queue.
+                if (numQueued == 0) {
+                    stopUring(offset);
+                }
+                break;
+            }
+            offsets[slot] = offset;
+            results[slot].reset();
+            offset += blockSize;
+            ++numQueued;
+            ++numInFlight;
+        }
+    }
+
+    // Wait for a read to finish.
+    void reap()
+    {
+        auto [slot, result] = uring->wait();
+        if (slot == UringReader::noTag) {
+            throwReadError();
+        }
+        results[slot] = result;
+        --numInFlight;
+    }
+
+    // Wait for the reads in flight and forget the queued ones, so that the
+    // file can be read again from a given offset.
+    void discardQueued(uint64_t newOffset)
+    {
+        while (numInFlight > 0) {
+            reap();
+        }
+        numQueued = 0;
+        offset = newOffset;
+    }
+
+    // Carry on from where io_uring left off with ordinary reads.
+    void stopUring(uint64_t newOffset)
+    {
+        discardQueued(newOffset);
+        uring.reset();
+        lseek(fd, off_t(newOffset), SEEK_SET);
+    }
+#endif
+
+public:
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    // Open a file, or stdin if the filename is empty.
+    explicit BlockReader(std::string_view filename)
+        : name(filename.empty() ? "stdin" : filename)
+    {
+        for (auto&& buffer : buffers) {
+            buffer = std::make_unique<char[]>(blockSize);
+        }
+#ifdef __linux__
+        if (filename.empty()) {
+            fd = STDIN_FILENO;
+        } else {
+            fd = open(std::string(filename).c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw std::runtime_error(std::format("Failed to open file {}", filename));
+            }
+            fOwnFd = true;
+        }
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            uring = std::make_unique<UringReader>(numBuffers);
+            if (uring->ok()) {
+                // (The io_uring reads don't move the file position.)
+                offset = uint64_t(lseek(fd, 0, SEEK_CUR));
+                fill();
+            } else {
+                uring.reset();
+            }
+        }
+#else
+        if (!filename.empty()) {
+            inFile.open(std::string(filename), std::ios::in | std::ios::binary);
+            if (inFile.fail()) {
+                throw std::runtime_error(std::format("Failed to open file {}", filename));
+            }
+            input = &inFile;
+        }
+#endif
+    }
+
+    ~BlockReader()
+    {
+#ifdef __linux__
+        // (The kernel may still be writing to the buffers.)
+        while (uring && numInFlight > 0) {
+            uring->wait();
+            --numInFlight;
+        }
+        if (fOwnFd) {
+            close(fd);
+        }
+#endif
+    }
+
+    // Return the next block of the file, which is valid until the next call,
+    // or an empty block at the end of the file.
+    std::span<const char> next()
+    {
+#ifdef __linux__
+        if (uring) {
+            if (fReturned) {
+                fReturned = false;
+                current = (current + 1) % numBuffers;
+            }
+            fill();
+        }
+        if (uring) {
+            if (numQueued == 0) {
+                return {};
+            }
+            while (!results[current]) {
+                reap();
+            }
+            int result = *results[current];
+            uint64_t blockOffset = offsets[current];
+            --numQueued;
+            if (result == -EINVAL || result == -EOPNOTSUPP) {
+                // This kernel doesn't have IORING_OP_READ (Linux 5.6+).
+                stopUring(blockOffset);
+            } else if (result < 0) {
+                throwReadError();
+            } else {
+                if (size_t(result) < blockSize) {
+                    // The end of the file, or a short read. Either way, the
+                    // reads queued after this one start in the wrong place.
+                    discardQueued(blockOffset + uint64_t(result));
+                    fEnd = (result == 0);
+                }
+                fReturned = true;
+                return { buffers[current].get(), size_t(result) };
+            }
+        }
+        ssize_t result;
+        do {
+            result = read(fd, buffers[current].get(), blockSize);
+        } while (result < 0 && errno == EINTR);
+        if (result < 0) {
+            throwReadError();
+        }
+        return { buffers[current].get(), size_t(result) };
+#else
+        input->read(buffers[current].get(), blockSize);
+        if (input->bad()) {
+            throwReadError();
+        }
+        return { buffers[current].get(), size_t(input->gcount()) };
+#endif
+    }
+};
@@ -0,0 +1,96 @@
+// Copyright (c) Len Popp
+// This source code is licensed under the MIT license - see LICENSE file.
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <ranges>
+#include <stdexcept>
+
+// A vector with a fixed maximum size, whose elements are stored inside the
+// object instead of on the heap.
+// It has enough of std::vector's interface to be used in its place, including
+// with std::ranges::to. Adding more than capacity elements throws
+// std::length_error.
+template<class T, size_t capacity_>
+class FixedVector
+{
+private:
+    std::array<T, capacity_> elements;
+    size_t count = 0;
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    FixedVector() = default;
+
+    template<std::ranges::input_range R>
+    FixedVector(std::from_range_t, R&& range)
+    {
+        for (auto&& elem : range) {
+            push_back(elem);
+        }
+    }
+
+    iterator begin() { return elements.data(); }
+    iterator end() { return elements.data() + count; }
+    const_iterator begin() const { return elements.data(); }
+    const_iterator end() const { return elements.data() + count; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    static constexpr size_t capacity() { return capacity_; }
+    static constexpr size_t max_size() { return capacity_; }
+
+    void reserve(size_t n) const
+    {
+        if (n > capacity_) {
+            throw std::length_error("FixedVector capacity exceeded");
+        }
+    }
+
+    void clear() { count = 0; }
+
+    void push_back(const T& elem)
+    {
+        reserve(count + 1);
+        elements[count++] = elem;
+    }
+
+    template<class... Args>
+    T& emplace_back(Args&&... args)
+    {
+        reserve(count + 1);
+        return elements[count++] = T(std::forward<Args>(args)...);
+    }
+
+    T* data() { return elements.data(); }
+    const T* data() const { return elements.data(); }
+
+    T& operator[](size_t i) { return elements[i]; }
+    const T& operator[](size_t i) const { return elements[i]; }
+
+    T& front() { return elements[0]; }
+    const T& front() const { return elements[0]; }
+    T& back() { return elements[count - 1]; }
+    const T& back() const { return elements[count - 1]; }
+
+    friend bool operator==(const FixedVector& a, const FixedVector& b)
+    {
+        return std::ranges::equal(a, b);
+    }
+
+    friend auto operator<=>(const FixedVector& a, const FixedVector& b)
+    {
+        return std::lexicographical_compare_three_way(
+            a.begin(), a.end(), b.begin(), b.end());
+    }
+};
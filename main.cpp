@@ -3,20 +3,45 @@
 
 #include <algorithm>
 #include <array>
+#include <bitset>
 #include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <optional>
 #include <print>
 #include <random>
 #include <ranges>
+#include <set>
 #include <span>
 #include <string_view>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
 #include <vector>
 
+#include "blockreader.h"
+#include "fixedvector.h"
+#include "packedrows.h"
+#include "perfcount.h"
+#include "rankselect.h"
+#include "shmring.h"
+#include "tcp.h"
 #include "timer.h"
 
 // Definitions for command line options and help text (see cmdline.h)
@@ -26,11 +51,30 @@
 #define CMDLINE_OPTIONS(ITEM) \
     /* ITEM(id, nameShort, nameLong, valType, defVal, help) */ \
     ITEM(Init, i, init, std::string, "raise", "Initial guess word (default \"raise\", may be empty)") \
+    ITEM(From, f, from, std::string, "", "Hints for a mid-game starting state (--solve, --all)") \
     ITEM(HardMode, d, hard, bool, false, "Hard mode - guesses must match hints") \
+    ITEM(Official, o, official, bool, false, "Hard mode with the official rules - guesses must reuse green and yellow letters") \
+    ITEM(Consistent, c, consistent, bool, false, "Strict hard mode - every guess must give the same hints as the guesses so far") \
     ITEM(Play, p, play, bool, false, "Play a game") \
+    ITEM(Query, j, query, bool, false, "Answer queries from stdin - see below") \
+    ITEM(QueryStates, S, query-states, unsigned, 10000, "With --query: the most game states to remember, including the start state - the least recently used are forgotten (default 10000, at least 2)") \
+    ITEM(Shm, z, shm, std::string, "", "With --query: take queries from the shared memory channel with this name instead of stdin (Linux only)") \
     ITEM(Solve, s, solve, bool, false, "Solve for the given answers") \
     ITEM(SolveAll, a, all, bool, false, "Solve all possible answers - slow!") \
+    ITEM(Improve, I, improve, unsigned, 0, "With --all: spend up to this many seconds improving the strategy first") \
+    ITEM(Coordinate, n, coordinate, unsigned, 0, "With --all: hand out the answers to --worker processes on this TCP port") \
+    ITEM(Worker, w, worker, std::string, "", "Solve answers handed out by an --all --coordinate process at host:port") \
     ITEM(ShowStats, x, stats, bool, false, "Display stats from a results file") \
+    ITEM(Compare, u, compare, std::string, "", "Compare the next guess with guessing this word instead, by solving random answers until one is clearly better") \
+    ITEM(Random, g, random, unsigned, 0, "Play this many games as a player who guesses random words that match the hints, and display stats") \
+    ITEM(Export, e, export, bool, false, "Export the most-used part of the strategy to a file") \
+    ITEM(MaxSize, m, max-size, unsigned, 65536, "Maximum size in bytes of an --export file (default 65536)") \
+    ITEM(Ranking, r, ranking, std::string, "", "File to load and save the ranking of best guesses, to speed up solving") \
+    ITEM(Shortlist, l, shortlist, unsigned, 0, "Only try this many of the best guesses from --ranking - faster, but might not find the best guess") \
+    ITEM(Verify, y, verify, bool, false, "Measure how much --shortlist changes the guesses in the strategy tree after the first guess") \
+    ITEM(Endgame, k, endgame, unsigned, 0, "Play optimally when this many or fewer answers are left (--solve, --all, --export)") \
+    ITEM(Profile, q, profile, bool, false, "Display time and hardware counters for each phase (counting threads started during the phase)") \
+    ITEM(Feedback, b, feedback, std::string, "", "Hint rules: wordle, peaks or mastermind (default: classic wordler hints)") \
     ITEM(Verbose, v, verbose, bool, true, "Display more output (default true)") \
     ITEM(Test, t, test, unsigned, 0, "Test mode")
 #define CMDLINE_ALLOW_ARGS true
@@ -38,9 +82,24 @@
     "Other arguments depend on the options given.\n" \
     "With no options, args are the known hints. Each hint is a pair of args:\n" \
     "    First is the word guessed (5 letters)\n" \
-    "    Second is the Wordle hint ('g' for green, 'y' for yellow, '.' for grey)\n" \
+    "    Second is the Wordle hint ('g' for green, 'y' for yellow, '.' for grey,\n" \
+    "    '?' if the colour isn't known - not with --hard or --official)\n" \
     "--solve: args are a list of answer words to solve\n" \
+    "--solve, --all, --random, --compare: --from=\"raise y.gy. thumb yg...\" starts from the given hints\n" \
+    "--worker: give the same options as the coordinator (e.g. --hard)\n" \
+    "--query: each line of input is a state token (0 to start), optionally\n" \
+    "    followed by a guess and its hint, e.g. \"0 raise y.gy.\". The reply is\n" \
+    "    the next guess and the new state's token, e.g. \"thumb 1\"\n" \
+    "    With --shm, the query \"quit\" stops the server\n" \
+    "    A token that was forgotten (see --query-states) gives \"error Unknown token\"\n" \
+    "--all --improve: arg is a results file to compare with (default results.txt)\n" \
     "--stats: arg is a filename containing output from --all (or stdin if omitted)\n" \
+    "--feedback: hints are given as for wordle, or for peaks ('g' for green,\n" \
+    "    'd'/'u' if the answer's letter is earlier/later in the alphabet),\n" \
+    "    or for mastermind (number of letters in the right place, then\n" \
+    "    number of other right letters, e.g. 21)\n" \
+    "--export: args are the output filename and optionally a file of answer\n" \
+    "    frequencies (\"word, count\" lines) used to weight the game states\n" \
     "--test: args depend on which test is selected."
 
 #include "cmdline.h"
@@ -58,12 +117,13 @@ static constexpr const word_t& nonWord()
     return nonWord_;
 }
 
-// wordList_t is a list of words
-using wordList_t = std::vector<word_t>;
-
 // Number of guesses allowed
 static constexpr unsigned maxGuesses = 6;
 
+// Number of guesses allowed in hard mode, where there might not be a
+// solution in maxGuesses
+static constexpr unsigned maxGuessesHard = 99;
+
 // solution_t is an answer word and the number of guesses that it took to solve
 using solution_t = std::pair<word_t, unsigned>;
 
@@ -97,12 +157,13 @@ static void checkWord(std::span<const char> word)
 }
 
 // Verify that the given hint is OK (5 special characters).
-static void checkHint(std::span<const char> hint)
+// If fWildcards is true, the hint may also have '?' for an unknown colour.
+static void checkHint(std::span<const char> hint, bool fWildcards = false)
 {
     if (hint.size() != wordLen)
         throwHintError(hint);
-    if (!std::ranges::all_of(hint, [](auto&& ch) {
-        return ch == 'g' || ch == 'y' || ch == '.';
+    if (!std::ranges::all_of(hint, [fWildcards](auto&& ch) {
+        return ch == 'g' || ch == 'y' || ch == '.' || (fWildcards && ch == '?');
         }))
     {
         throwHintError(hint);
@@ -154,6 +215,21 @@ static constexpr word_t allGuesses[] = {
 #include "words-guess.h"
 };
 
+// Maximum number of words in a word list
+static constexpr size_t maxWords = std::max(std::size(allTargets), std::size(allGuesses));
+
+// If WORDLER_FIXED_CAPACITY is defined, lists used while solving have a fixed
+// maximum size and don't use the heap. This makes it possible to use
+// getNextGuess() where heap allocation is not allowed, and gives it a
+// predictable worst-case time.
+#ifdef WORDLER_FIXED_CAPACITY
+// wordList_t is a list of words
+using wordList_t = FixedVector<word_t, maxWords>;
+#else
+// wordList_t is a list of words
+using wordList_t = std::vector<word_t>;
+#endif
+
 // Select an answer word randomly
 static word_t getRandomTarget()
 {
@@ -198,12 +274,67 @@ static void lvprintln(std::format_string<Args...> fmt, Args&&... args)
     }
 }
 
+// Count of guess words scored by getNextGuessSub(), for --profile
+static unsigned long long& guessesScored()
+{
+    static unsigned long long count = 0;
+    return count;
+}
+
+// Run one phase of the program. If the --profile option is given, display the
+// time it takes and the hardware event counts (where available).
+static void runPhase(std::string_view name, std::invocable auto func)
+{
+    if (!CommandLine::GetProfile()) {
+        func();
+        return;
+    }
+    unsigned long long scoredStart = guessesScored();
+    double t = 0.0;
+    PerfCounts counts = countEvents([&]() { t = runTime(func); });
+    unsigned long long scored = guessesScored() - scoredStart;
+    std::println("Profile: {}: {:.03f} seconds, {} guesses scored", name, t, scored);
+    if (!counts.cycles || !counts.instructions) {
+        std::println("    Hardware counters not available");
+        return;
+    }
+    std::println("    {} cycles, {} instructions, IPC {:.2f}",
+        *counts.cycles, *counts.instructions,
+        double(*counts.instructions) / double(std::max(*counts.cycles, uint64_t(1))));
+    if (counts.fScaled) {
+        std::println("    (Counters were shared with other programs - counts are estimated)");
+    }
+    // Display a count in total, and per guess scored if there were any.
+    auto printCount = [scored](std::string_view what, std::optional<uint64_t> count) {
+        if (!count) {
+            std::println("    {}: not available", what);
+        } else if (scored == 0) {
+            std::println("    {}: {}", what, *count);
+        } else {
+            std::println("    {}: {} ({:.1f} per guess scored)",
+                what, *count, double(*count) / double(scored));
+        }
+        };
+    printCount("Cache misses", counts.cacheMisses);
+    printCount("Branch mispredictions", counts.branchMisses);
+}
+
+// pattern_t is a hint pattern encoded as a number from 0 to 3^5-1
+// (see Hint::getPattern())
+using pattern_t = uint8_t;
+
+// Number of different hint patterns
+static constexpr unsigned numHintPatterns = 3 * 3 * 3 * 3 * 3;
+
+// patternSet_t is a set of hint patterns: bit p is pattern p
+using patternSet_t = std::bitset<numHintPatterns>;
+
 // A guess-hint pair with a match() function
 class Hint
 {
 private:
     word_t guess;   // guess word - 5 letters, lower case
-    word_t hint;    // hint chars ('g', 'y', or '.')
+    word_t hint;    // hint chars ('g', 'y', '.', or '?' if unknown)
 
 public:
     // Construct a Hint from a guess word and a hint pattern.
@@ -213,11 +344,18 @@ public:
         hint = hintIn;
     }
 
+    // Construct an empty Hint, e.g. for a FixedVector<Hint>.
+    Hint()
+    {
+        guess = nonWord();
+        hint = nonWord();
+    }
+
     explicit Hint(std::string_view guessIn, std::string_view hintIn)
     {
         checkWord(guessIn);
         copyWordFrom(guess, guessIn);
-        checkHint(hintIn);
+        checkHint(hintIn, true);
         copyWordFrom(hint, hintIn);
     }
 
@@ -225,8 +363,41 @@ public:
 
     const word_t& getHint(this auto&& self) { return self.hint; }
 
+    // Return true if some of the hint's colours aren't known ('?').
+    // Hints like that can't be matched with match() or getPattern(), only
+    // with couldBe() (see filterConsistent()).
+    bool hasWildcards() const
+    {
+        return std::ranges::contains(hint, '?');
+    }
+
+    // Return true if this hint could be the given pattern, i.e. the pattern
+    // has the same colours except where this hint has '?'.
+    bool couldBe(pattern_t pattern) const
+    {
+        for (auto&& ch : hint | std::views::reverse) {
+            unsigned colour = pattern % 3;
+            pattern /= 3;
+            if (ch != '?' && colour != ((ch == 'g') ? 2u : (ch == 'y') ? 1u : 0u)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Return the set of patterns this hint could be (see couldBe()).
+    patternSet_t getPatterns() const
+    {
+        patternSet_t patterns;
+        for (unsigned pattern = 0; pattern < numHintPatterns; ++pattern) {
+            patterns[pattern] = couldBe(pattern_t(pattern));
+        }
+        return patterns;
+    }
+
     // Match a word against this hint.
     // Returns true if word matches this, false if not.
+    // Not for hints with wildcards, which only couldBe() handles.
     bool match(const word_t& word) const
     {
         // Keep track of letters that have been matched and ignore them later.
@@ -287,6 +458,17 @@ public:
         return true;
     }
 
+    // Return the hint as a pattern number, treating the hint chars as the
+    // digits of a base-3 number ('.'=0, 'y'=1, 'g'=2).
+    pattern_t getPattern() const
+    {
+        unsigned pattern = 0;
+        for (auto&& ch : hint) {
+            pattern = pattern * 3 + ((ch == 'g') ? 2 : (ch == 'y') ? 1 : 0);
+        }
+        return pattern_t(pattern);
+    }
+
     void print() const
     {
         std::println("{} {}", std::string_view(guess), std::string_view(hint));
@@ -328,6 +510,14 @@ public:
     }
 };
 
+#ifdef WORDLER_FIXED_CAPACITY
+// hintList_t is a list of Hints, enough for a whole game
+using hintList_t = FixedVector<Hint, maxGuessesHard>;
+#else
+// hintList_t is a list of Hints
+using hintList_t = std::vector<Hint>;
+#endif
+
 // Make a list of Hints from the given command line arguments.
 // Each consecutive pair of args is a guess-hint pair for a Hint.
 // Returns an unevaluated view.
@@ -339,17 +529,55 @@ static std::ranges::view auto makeHints(const std::ranges::range auto& args)
             });
 }
 
+// Lists of at least this many words are filtered in parallel by
+// filterTargets(). Smaller lists aren't worth starting threads for.
+static constexpr size_t parallelFilterSize = 4096;
+
 // Filter a list of target words and return the ones matching a list of hints.
 static wordList_t filterTargets(const std::ranges::range auto& hints,
     const std::ranges::range auto& targetsIn)
 {
-    wordList_t targets = targetsIn
-        | std::views::filter([&hints](auto&& word) {
-            return std::ranges::all_of(hints, [&word](auto&& hint) {
-                return hint.match(word);
+    auto matchesHints = [&hints](const word_t& word) {
+        return std::ranges::all_of(hints, [&word](auto&& hint) {
+            return hint.match(word);
+            });
+        };
+#ifndef WORDLER_FIXED_CAPACITY
+    // (Not with a fixed capacity, because the parallel algorithms can use the
+    // heap.)
+    if constexpr (std::ranges::contiguous_range<decltype(targetsIn)>) {
+        std::span<const word_t> words{ targetsIn };
+        if (words.size() >= parallelFilterSize) {
+            // Count the matching words in parallel: counts[i] is the number of
+            // matches up to and including words[i]. A word matches if the
+            // count goes up there, and the count is then its position + 1 in
+            // the result, so it ends up in the same order as the serial
+            // filter below.
+            std::vector<size_t> counts(words.size());
+            std::transform_inclusive_scan(std::execution::par_unseq,
+                words.begin(), words.end(), counts.begin(), std::plus<>(),
+                [&matchesHints](const word_t& word) {
+                    return size_t(matchesHints(word));
                 });
-            })
-        | std::ranges::to<std::vector>();
+            // The scatter goes over a list of indexes, because a parallel
+            // algorithm may pass it copies of the elements, so an element's
+            // address can't be used to find its index.
+            wordList_t targets(counts.back());
+            std::vector<size_t> indexes(words.size());
+            std::iota(indexes.begin(), indexes.end(), size_t(0));
+            std::for_each(std::execution::par_unseq, indexes.begin(), indexes.end(),
+                [&](size_t i) {
+                    if (counts[i] != ((i == 0) ? 0 : counts[i - 1])) {
+                        targets[counts[i] - 1] = words[i];
+                    }
+                });
+            return targets;
+        }
+    }
+#endif
+    wordList_t targets = targetsIn
+        | std::views::filter(matchesHints)
+        | std::ranges::to<wordList_t>();
     return targets;
 }
 
@@ -360,337 +588,2689 @@ static wordList_t filterTargets(const Hint& hint,
     return filterTargets(std::views::single(hint), targetsIn);
 }
 
-using score_t = unsigned long long;
-using guessScore_t = std::pair<word_t, score_t>;
-
-// Evaluate all guesses against a list of targets and return the best guess.
-// Helper routine for getNextGuess().
-static guessScore_t getNextGuessSub(const std::ranges::range auto& targets,
-    const std::ranges::range auto& guessWords)
+// Filter a list of words, returning only the ones that would give exactly the
+// same hints as the list of hints if they were the answer.
+// This is stricter than filterTargets() - e.g. a word doesn't match a yellow
+// letter if it has that letter in the same place.
+// A hint with wildcards ('?') is matched by a word that would give any of the
+// hints it could be, so each word is still only compared with it once.
+static wordList_t filterConsistent(const std::ranges::range auto& hints,
+    const std::ranges::range auto& wordsIn)
 {
-    // Check a couple of special cases.
-    if (targets.empty()) {
-        // Oops, no matching words at all!
-        throwError("No matching words found.");
-    } else if (targets.size() <= 2) {
-        // Only two possibilities remain - pick one.
-        // This prevents an extra roundabout guess when there are only 2 alternatives.
-        const word_t& guess = targets.front();
-        return { guess, 0 };
-    }
-
-    // Test all guess words, looking for the best one.
-    // A good guess is one that is expected to cut down the target list as much
-    // as possible.
-    static constexpr guessScore_t worstGuess =
-        guessScore_t(nonWord(), std::numeric_limits<score_t>::max());
-#ifdef LOOP_IMPL
-    // Implementation with loops
-    guessScore_t best = worstGuess;
-    for (auto&& guess : guessWords) {
-        // Score this guess based on how few matches it allows, over all possible
-        // correct answers (targets).
-        score_t score = 0;
-        for (auto&& target : targets) {
-            Hint hint = Hint::fromGuess(target, guess);
-            score += std::ranges::count_if(targets, [&hint](auto&& word) {
-                return hint.match(word);
-                });
-        }
-        if (score < best.second) {
-            best = guessScore_t(guess, score);
-        }
-    }
-#else
-    // Implementation with ranges and algorithms
-    // (no faster but certainly uglier)
-    // Compute numeric scores for all possible guesses.
-    auto guessScores = guessWords
-        | std::views::transform([&targets](auto&& guess) {
-        auto scores = targets
-            | std::views::transform([&targets, &guess](auto&& target) {
-                Hint hint = Hint::fromGuess(target, guess);
-                return std::ranges::count_if(targets, [&hint](auto&& word) {
-                    return hint.match(word);
-                    });
+    return wordsIn
+        | std::views::filter([&hints](auto&& word) {
+            return std::ranges::all_of(hints, [&word](auto&& hint) {
+                return hint.couldBe(Hint::fromGuess(word, hint.getGuess()).getPattern());
                 });
-        score_t score = std::accumulate(scores.begin(), scores.end(), 0ull);
-        return guessScore_t(guess, score);
-            });
-    // Choose the guess with the best (lowest) score.
-    guessScore_t best =
-        std::accumulate(guessScores.begin(), guessScores.end(), worstGuess,
-            [](auto&& min, auto&& next) {
-                return (next.second < min.second) ? next : min;
-            });
-#endif
-
-    return best;
+            })
+        | std::ranges::to<wordList_t>();
 }
 
-// Choose the best word to guess next, given that the correct answer is in a
-// list of target words.
-static word_t getNextGuess(const std::ranges::range auto& targets,
-    const std::ranges::range auto& guessWords)
+// Filter a list of words, returning only the ones exactly consistent with a
+// single hint.
+static wordList_t filterConsistent(const Hint& hint,
+    const std::ranges::range auto& wordsIn)
 {
-    // guess1 is the best guess that could possibly be a correct answer,
-    // guess2 is the best guess of any valid word.
-    guessScore_t guess1 = getNextGuessSub(targets, targets);
-    guessScore_t guess2 = getNextGuessSub(targets, guessWords);
-    // Compare scores of guess1 and guess2, giving a slight preference to a
-    // guess that could fortuitously be the correct answer.
-    static constexpr double preference = 1.1;
-    const guessScore_t& guess =
-        (guess1.second <= score_t(preference * guess2.second + 1))
-            ? guess1 : guess2;
-    return guess.first;
+    return filterConsistent(std::views::single(hint), wordsIn);
 }
 
-// Solve for a given target word by calling getNextGuess() repeatedly.
-static solution_t solveWord(const word_t& target,
-    const std::ranges::range auto& targetWords,
-    const std::ranges::range auto& guessWords,
-    bool fPrintGuesses)
+// Return one row of the guess-by-guess pattern table: the pattern numbers of
+// the hints given by guessing the given word, if each word in allGuesses in
+// turn were the answer.
+// A guess word is consistent with a hint exactly if its entry in the row for
+// the hint's guess is the hint's pattern, so a hard mode filter is just a scan
+// of the row. Rows are made when first needed and then kept, since only a few
+// hundred different words are normally guessed; the whole table would take
+// 11882 x 11882 bytes.
+static const std::vector<pattern_t>& getPatternRow(const word_t& guess)
 {
-    // Keep the lists of currently plausible target and guess words in a std::vector.
-    wordList_t targets{ std::from_range, targetWords };
-    wordList_t guesses{ std::from_range, guessWords };
-    // Make guesses to refine the targets list until the answer is found
-    // or all guesses are used up.
-    // For "hard mode", allow more guesses because it's not guaranteed to
-    // succeed every time.
-    unsigned maxGuessesT = CommandLine::GetHardMode() ? 99 : maxGuesses;
-    for (unsigned i = 0; i < maxGuessesT; ++i) {
-        word_t guess = nonWord();
-        if (targets.size() == 1) {
-            // Only one possibility left, this should be the answer.
-            guess = targets.front();
-        } else if (i == 0 && hasFirstGuess()) {
-            // Use the default first guess.
-            guess = getFirstGuess();
-        } else {
-            guess = getNextGuess(targets, guesses);
-        }
-        if (fPrintGuesses) {
-            lvprint("Guess #{} is ", i + 1);
-            lprintln("\"{}\"", std::string_view(guess));
-        }
-        // Is this the correct answer?
-        if (std::string_view(guess) == std::string_view(target)) {
-            // Return the answer and the number of guesses.
-            return { guess, i + 1 };
-        }
-        // Filter the targets list according to the latest guess.
-        Hint hint = Hint::fromGuess(target, guess);
-        targets = filterTargets(hint, targets);
-        // In hard mode, the guesses must also be limited by the hints.
-        // This is a bit inefficient when _not_ in hard mode because it copies
-        // the entire guess list unnecessarily.
-        if (CommandLine::GetHardMode()) {
-            guesses = filterTargets(hint, guesses);
-        }
-        if (targets.empty()) {
-            // Oops, no matching words at all!
-            throwError("No matching words found.");
-        }
+    static std::map<word_t, std::vector<pattern_t>> rows;
+    auto found = rows.find(guess);
+    if (found != rows.end()) {
+        return found->second;
     }
-    throwError(std::format("Answer \"{}\" was not found in {} tries.",
-        std::string_view(target), maxGuessesT).c_str());
+    std::vector<pattern_t> row = allGuesses
+        | std::views::transform([&guess](auto&& word) {
+            return Hint::fromGuess(word, guess).getPattern();
+            })
+        | std::ranges::to<std::vector>();
+    return rows.emplace(guess, std::move(row)).first->second;
 }
 
-// Display the word to guess next, based on the hints given on thte command line.
-static void doNextGuess(auto args)
+// Feedback policies
+// A feedback policy defines the hints given for a guess in a Wordle-like
+// game. It has these static members:
+//     name - the name used for the --feedback option
+//     numPatterns - the number of different hints
+//     getPattern(target, guess) - the hint for a guess, as a pattern number
+//     parseHint(hint) - convert a hint from the command line to a pattern number
+//     formatHint(pattern) - convert a pattern number to a string
+// A policy is used to choose guesses by counting the targets that give each
+// pattern (see getNextGuessSub()) instead of using Hint::match().
+
+// Wordle feedback: green, yellow or grey for each letter.
+// This is the same as the Hint class except that a word only matches a hint
+// if it would give exactly the same hint (see filterConsistent()).
+struct WordleFeedback
 {
-    if (args.empty() && hasFirstGuess() ) {
-        // Use the default first guess.
-        lprintln("First guess is \"{}\"", std::string_view(getFirstGuess()));
-    } else {
-        // The command line args are the hints given so far.
-        if ((args.size() % 2) != 0) {
-            throwError("An even number of arguments is required.");
-        }
-        word_t guess = nonWord();
-        // Find a good next guess. Show how long it takes.
-        double t = runTime([&]() {
-            auto hints = makeHints(args);
-            wordList_t targets = filterTargets(hints, allTargets);
-            // In "hard mode" the list of guess words must be filtered by the
-            // hints seen so far. This is a bit inefficient when _not_ in hard
-            // mode because it copies the entire guess list unnecessarily.
-            wordList_t guessList;
-            if (CommandLine::GetHardMode()) {
-                guessList = filterTargets(hints, allGuesses);
-            } else {
-                guessList = allGuesses | std::ranges::to<std::vector>();
-            }
-            guess = getNextGuess(targets, guessList);
-            });
-        lvprintln("Time: {:.02f} seconds", t);
-        lprintln("Best guess is \"{}\"", std::string_view(guess));
+    static constexpr std::string_view name = "wordle";
+    static constexpr unsigned numPatterns = 3 * 3 * 3 * 3 * 3;
+
+    static pattern_t getPattern(const word_t& target, const word_t& guess)
+    {
+        return Hint::fromGuess(target, guess).getPattern();
     }
-}
 
-// Read a guess word from an input stream. Repeat until a valid guess is entered.
-static std::optional<word_t> getInputGuess(std::istream& input,
-    unsigned i,
-    const std::ranges::range auto& guessWords)
-{
-    for (;;) {
-        std::string sWord;
-        lvprint("Guess #{}: ", i);
-        if (!std::getline(input, sWord)) {
-            // input error or EOF
-            return std::nullopt;
-        }
-        if (sWord.length() == wordLen) {
-            // Kludgy way to check if guess is a valid guess word
-            word_t word;
-            copyWordFrom(word, sWord);
-            Hint hint = Hint::fromGuess(word, word);
-            wordList_t matches = filterTargets(hint, guessWords);
-            if (std::size(matches) == 1
-                && std::string_view(matches.front()) == sWord)
-            {
-                return word;
-            }
+    static pattern_t parseHint(std::string_view hintIn)
+    {
+        checkHint(hintIn);
+        word_t hint;
+        copyWordFrom(hint, hintIn);
+        return Hint(nonWord(), hint).getPattern();
+    }
+
+    static std::string formatHint(pattern_t pattern)
+    {
+        std::string hint(wordLen, '.');
+        for (auto&& ch : hint | std::views::reverse) {
+            ch = ".yg"[pattern % 3];
+            pattern /= 3;
         }
-        std::println("Invalid guess - try again");
+        return hint;
     }
-}
+};
 
-// Play a game
-static void doPlayGame(auto args)
+// Wordle Peaks feedback: for each letter, green if it's right, otherwise
+// whether the answer's letter is earlier ('d') or later ('u') in the alphabet.
+struct PeaksFeedback
 {
-    word_t answer = getRandomTarget();
-    wordList_t guesses{ std::from_range, allGuesses };
-    for (unsigned i = 1; i <= maxGuesses; ++i) {
-        auto guessOpt = getInputGuess(std::cin, i, guesses);
-        if (!guessOpt) {
-            // Error, or gave up
-            return;
-        }
-        word_t guess = guessOpt.value();
-        if (std::string_view(guess) == std::string_view(answer)) {
-            // Done!
-            lvprintln("Correct! Answer \"{}\" was found in {} tries.",
-                std::string_view(answer), i);
-            return;
-        }
-        Hint hint = Hint::fromGuess(answer, guess);
-        lprintln("          {}", std::string_view(hint.getHint()));
-        if (CommandLine::GetHardMode()) {
-            guesses = filterTargets(hint, guesses);
+    static constexpr std::string_view name = "peaks";
+    static constexpr unsigned numPatterns = 3 * 3 * 3 * 3 * 3;
+
+    static pattern_t getPattern(const word_t& target, const word_t& guess)
+    {
+        unsigned pattern = 0;
+        for (auto&& [chTarget, chGuess] : std::views::zip(target, guess)) {
+            pattern = pattern * 3
+                + ((chTarget == chGuess) ? 2 : (chTarget > chGuess) ? 1 : 0);
         }
+        return pattern_t(pattern);
     }
-    lvprintln("Answer \"{}\" was not found in {} tries.",
-        std::string_view(answer), maxGuesses);
-}
 
-// Show the solution for the target word given on the command line.
-static void doSolve(auto args)
-{
-    // Play games automatically with given target words.
-    for (auto&& arg : args) {
-        word_t target;
-        checkWord(arg);
-        copyWordFrom(target, arg);
-        lvprintln("Target: \"{}\"", std::string_view(target));
-        solution_t s;
-        double t = runTime([&]() {
-            s = solveWord(target, allTargets, allGuesses, true);
-            });
-        lvprintln("Time: {:.02f} seconds", t);
-        lvprint("Answer: \"{}\" in ", std::string_view(s.first));
-        lprintln("{} tries", s.second);
+    static pattern_t parseHint(std::string_view hint)
+    {
+        if (hint.size() != wordLen)
+            throwHintError(hint);
+        unsigned pattern = 0;
+        for (char ch : hint) {
+            auto pos = std::string_view("dug").find(ch);
+            if (pos == std::string_view::npos)
+                throwHintError(hint);
+            pattern = pattern * 3 + unsigned(pos);
+        }
+        return pattern_t(pattern);
     }
-}
 
-// Solve for _all_ target words. (This takes hours to run.) Print the number of
-// guesses required for each word.
-static void doSolveAll(auto args)
-{
-    for (auto&& target : allTargets) {
-        solution_t s = solveWord(target, allTargets, allGuesses, false);
-        std::println("{}, {}", std::string_view(s.first), s.second);
-        std::cout.flush();
+    static std::string formatHint(pattern_t pattern)
+    {
+        std::string hint(wordLen, '.');
+        for (auto&& ch : hint | std::views::reverse) {
+            ch = "dug"[pattern % 3];
+            pattern /= 3;
+        }
+        return hint;
     }
-}
+};
 
-// Throw an error for invalid data in a results file.
-[[noreturn]] static void throwResultsError(std::string_view line)
+// Mastermind-style feedback: the number of letters in the right place
+// ("black pegs") and the number of other letters that are in the answer
+// ("white pegs").
+struct MastermindFeedback
 {
-    throwError(std::format("Bad results data: \"{}\"", line).c_str());
-}
+    static constexpr std::string_view name = "mastermind";
+    static constexpr unsigned numPatterns = (wordLen + 1) * (wordLen + 1);
+
+    static pattern_t getPattern(const word_t& target, const word_t& guess)
+    {
+        unsigned black = 0;
+        std::array<unsigned, 26> countsTarget{};
+        std::array<unsigned, 26> countsGuess{};
+        for (auto&& [chTarget, chGuess] : std::views::zip(target, guess)) {
+            if (chTarget == chGuess) {
+                ++black;
+            }
+            ++countsTarget[chTarget - 'a'];
+            ++countsGuess[chGuess - 'a'];
+        }
+        unsigned common = 0;
+        for (auto&& [countT, countG] : std::views::zip(countsTarget, countsGuess)) {
+            common += std::min(countT, countG);
+        }
+        return pattern_t(black * (wordLen + 1) + (common - black));
+    }
+
+    static pattern_t parseHint(std::string_view hint)
+    {
+        if (hint.size() != 2)
+            throwHintError(hint);
+        unsigned black = unsigned(hint[0] - '0');
+        unsigned white = unsigned(hint[1] - '0');
+        if (black > wordLen || white > wordLen || black + white > wordLen)
+            throwHintError(hint);
+        return pattern_t(black * (wordLen + 1) + white);
+    }
+
+    static std::string formatHint(pattern_t pattern)
+    {
+        return std::format("{}{}", pattern / (wordLen + 1), pattern % (wordLen + 1));
+    }
+};
+
+// Return the number of hint patterns for a feedback policy, or 0 for the
+// classic Hint class (Feedback = void).
+template<class Feedback>
+static consteval size_t getNumPatterns()
+{
+    if constexpr (std::is_void_v<Feedback>) {
+        return 0;
+    } else {
+        return Feedback::numPatterns;
+    }
+}
+
+// Filter a list of target words, returning only the ones that would give the
+// given hint pattern for a guess under a feedback policy.
+template<class Feedback>
+static wordList_t filterFeedback(const word_t& guess, pattern_t pattern,
+    const std::ranges::range auto& targetsIn)
+{
+    return targetsIn
+        | std::views::filter([&guess, pattern](auto&& word) {
+            return Feedback::getPattern(word, guess) == pattern;
+            })
+        | std::ranges::to<wordList_t>();
+}
+
+// A hint given under a feedback policy: the guess and its hint pattern
+struct FeedbackHint
+{
+    word_t guess;
+    pattern_t pattern;
+
+    const word_t& getGuess() const
+    {
+        return guess;
+    }
+
+    pattern_t getPattern() const
+    {
+        return pattern;
+    }
+};
+
+#ifdef WORDLER_FIXED_CAPACITY
+// feedbackList_t is a list of FeedbackHints, enough for a whole game
+using feedbackList_t = FixedVector<FeedbackHint, maxGuessesHard>;
+#else
+// feedbackList_t is a list of FeedbackHints
+using feedbackList_t = std::vector<FeedbackHint>;
+#endif
+
+// Return the hint given by a guess if target is the answer: a Hint, or a
+// FeedbackHint with a feedback policy.
+template<class Feedback = void>
+static auto makeHint(const word_t& target, const word_t& guess)
+{
+    if constexpr (std::is_void_v<Feedback>) {
+        return Hint::fromGuess(target, guess);
+    } else {
+        return FeedbackHint{ guess, Feedback::getPattern(target, guess) };
+    }
+}
+
+// guessBits_t is a set of words from allGuesses, one bit per word
+using guessBits_t = std::bitset<std::size(allGuesses)>;
+
+// Index of the guess words by letter, for checking the official hard mode
+// rules quickly: green letters must be reused in the same place, and yellow
+// letters must be reused somewhere.
+class HardModeIndex
+{
+private:
+    // Words with a given letter at a given position: [position][letter]
+    std::array<std::array<guessBits_t, 26>, wordLen> letterAt;
+    // Words with at least n+1 of a given letter: [letter][n]
+    std::array<std::array<guessBits_t, wordLen>, 26> letterCount;
+
+    HardModeIndex()
+    {
+        for (auto&& [index, word] : std::views::enumerate(allGuesses)) {
+            std::array<unsigned, 26> counts{};
+            for (auto&& [pos, ch] : std::views::enumerate(word)) {
+                letterAt[pos][ch - 'a'].set(index);
+                ++counts[ch - 'a'];
+            }
+            for (auto&& [letter, count] : std::views::enumerate(counts)) {
+                for (unsigned n = 0; n < count; ++n) {
+                    letterCount[letter][n].set(index);
+                }
+            }
+        }
+    }
+
+public:
+    static const HardModeIndex& get()
+    {
+        static const HardModeIndex index;
+        return index;
+    }
+
+    // Return the set of guess words allowed by a list of hints.
+    guessBits_t legalGuesses(const std::ranges::range auto& hints) const
+    {
+        guessBits_t legal;
+        legal.set();
+        for (auto&& hint : hints) {
+            std::array<unsigned, 26> counts{};
+            for (auto&& [pos, chGuess, chHint]
+                : std::views::zip(std::views::iota(0u), hint.getGuess(), hint.getHint()))
+            {
+                if (chHint == 'g') {
+                    legal &= letterAt[pos][chGuess - 'a'];
+                }
+                if (chHint != '.') {
+                    ++counts[chGuess - 'a'];
+                }
+            }
+            for (auto&& [letter, count] : std::views::enumerate(counts)) {
+                if (count > 0) {
+                    legal &= letterCount[letter][count - 1];
+                }
+            }
+        }
+        return legal;
+    }
+};
+
+// Rules for which words may be guessed
+enum class GuessRules
+{
+    Any,        // normal mode
+    Hard,       // --hard: guesses must match the hints (Hint::match())
+    Official,   // --official: guesses must reuse green and yellow letters
+    Consistent  // --consistent: guesses must give exactly the same hints
+};
+
+// Return a name for a set of guess rules.
+static constexpr std::string_view getRulesName(GuessRules rules)
+{
+    switch (rules) {
+    case GuessRules::Hard: return "hard";
+    case GuessRules::Official: return "official";
+    case GuessRules::Consistent: return "consistent";
+    default: return "normal";
+    }
+}
+
+// Call func with the guess rules selected on the command line as its template
+// argument, e.g. func.operator()<GuessRules::Hard>().
+// The code that depends on the rules is a template, so that a separate
+// version of it is compiled for each set of rules without checking the
+// options in the middle of solving.
+// Only one set of rules may be selected.
+static void withGuessRules(auto func)
+{
+    if (int(CommandLine::GetHardMode()) + int(CommandLine::GetOfficial())
+        + int(CommandLine::GetConsistent()) > 1)
+    {
+        throwError("Only one of --hard, --official and --consistent can be given");
+    }
+    if (CommandLine::GetOfficial()) {
+        func.template operator()<GuessRules::Official>();
+    } else if (CommandLine::GetConsistent()) {
+        func.template operator()<GuessRules::Consistent>();
+    } else if (CommandLine::GetHardMode()) {
+        func.template operator()<GuessRules::Hard>();
+    } else {
+        func.template operator()<GuessRules::Any>();
+    }
+}
+
+// Return the number of guesses allowed to solve a game under a set of rules.
+// Hard mode allows more guesses, because it isn't sure to solve every answer
+// in the usual number, and so do other games (feedback policies).
+template<GuessRules rules, class Feedback = void>
+static constexpr unsigned getMaxGuesses()
+{
+    return (rules != GuessRules::Any || !std::is_void_v<Feedback>) ? maxGuessesHard : maxGuesses;
+}
+
+// Return the guess words that are allowed in hard mode after a list of hints.
+template<GuessRules rules>
+static wordList_t getHardModeGuesses(const std::ranges::range auto& hints)
+{
+    static_assert(rules != GuessRules::Any);
+    if constexpr (rules == GuessRules::Official || rules == GuessRules::Consistent) {
+        guessBits_t legal;
+        if constexpr (rules == GuessRules::Official) {
+            legal = HardModeIndex::get().legalGuesses(hints);
+        } else {
+            // Scan the pattern table row for each hint. (A hint with
+            // wildcards allows any of the patterns it could be.)
+            legal.set();
+            for (auto&& hint : hints) {
+                const std::vector<pattern_t>& row = getPatternRow(hint.getGuess());
+                const patternSet_t patterns = hint.getPatterns();
+                for (size_t i = 0; i < row.size(); ++i) {
+                    if (!patterns.test(row[i])) {
+                        legal.reset(i);
+                    }
+                }
+            }
+        }
+        wordList_t guesses;
+        guesses.reserve(legal.count());
+        for (size_t i = 0; i < legal.size(); ++i) {
+            if (legal.test(i)) {
+                guesses.push_back(allGuesses[i]);
+            }
+        }
+        return guesses;
+    } else {
+        return filterTargets(hints, allGuesses);
+    }
+}
+
+// Return the words in a list of guess words (in allGuesses order) whose
+// indexes in allGuesses pass a test.
+static wordList_t filterGuessIndexes(const wordList_t& guessesIn, auto isAllowed)
+{
+    wordList_t guesses;
+    const word_t* pos = std::begin(allGuesses);
+    for (auto&& word : guessesIn) {
+        pos = std::lower_bound(pos, std::end(allGuesses), word);
+        if (isAllowed(size_t(pos - std::begin(allGuesses)))) {
+            guesses.push_back(word);
+        }
+    }
+    return guesses;
+}
+
+// Return the guess words in a list that are still allowed in hard mode after
+// one more hint. Only the new hint is checked, so a game in progress doesn't
+// have to check all of its hints against all the guess words again.
+template<GuessRules rules>
+static wordList_t filterHardModeGuesses(const Hint& hint, const wordList_t& guessesIn)
+{
+    static_assert(rules != GuessRules::Any);
+    if constexpr (rules == GuessRules::Official) {
+        const guessBits_t legal = HardModeIndex::get().legalGuesses(std::views::single(hint));
+        return filterGuessIndexes(guessesIn, [&legal](size_t i) { return legal.test(i); });
+    } else if constexpr (rules == GuessRules::Consistent) {
+        const std::vector<pattern_t>& row = getPatternRow(hint.getGuess());
+        const patternSet_t patterns = hint.getPatterns();
+        return filterGuessIndexes(guessesIn, [&row, &patterns](size_t i) {
+            return patterns.test(row[i]);
+            });
+    } else {
+        return filterTargets(hint, guessesIn);
+    }
+}
+
+// Check that a hint with wildcards ('?') can be used with a set of guess
+// rules. Hard mode and official mode need to know the hint's colours to tell
+// which guesses are allowed.
+template<GuessRules rules>
+static void checkWildcards(const Hint& hint)
+{
+    if constexpr (rules == GuessRules::Hard || rules == GuessRules::Official) {
+        if (hint.hasWildcards()) {
+            throwError(std::format("Hints with '?' can't be used in {} mode",
+                getRulesName(rules)).c_str());
+        }
+    }
+}
+
+// A game in progress: the hints given so far and the lists of target and
+// guess words that are still possible, under the given guess rules.
+// With a feedback policy (normal mode only), the hints are FeedbackHints.
+template<GuessRules rules, class Feedback = void>
+struct GameState
+{
+    static_assert(std::is_void_v<Feedback> || rules == GuessRules::Any,
+        "Feedback policies are only used in normal mode");
+    static constexpr bool fClassic = std::is_void_v<Feedback>;
+    using hint_t = std::conditional_t<fClassic, Hint, FeedbackHint>;
+
+    std::conditional_t<fClassic, hintList_t, feedbackList_t> hints;
+    wordList_t targets;
+    // In hard mode, the guess words allowed by the hints.
+    // Not used in normal mode, where any word may be guessed.
+    wordList_t guesses;
+
+    // Return the list of guess words that may be guessed.
+    std::span<const word_t> getGuesses() const
+    {
+        if constexpr (rules == GuessRules::Any) {
+            return allGuesses;
+        } else {
+            return guesses;
+        }
+    }
+
+    // Apply another hint, narrowing down the lists of possible words.
+    void addHint(const hint_t& hint)
+    {
+        if constexpr (!fClassic) {
+            hints.push_back(hint);
+            targets = filterFeedback<Feedback>(hint.guess, hint.pattern, targets);
+        } else {
+            checkWildcards<rules>(hint);
+            hints.push_back(hint);
+            if constexpr (rules == GuessRules::Consistent) {
+                targets = filterConsistent(hint, targets);
+            } else if (hint.hasWildcards()) {
+                // Hints with wildcards can only be matched by filterConsistent().
+                // (Only normal mode gets here - see checkWildcards().)
+                targets = filterConsistent(hint, targets);
+            } else {
+                targets = filterTargets(hint, targets);
+            }
+            // In hard mode, the guesses must also be limited by the hints.
+            if constexpr (rules != GuessRules::Any) {
+                guesses = filterHardModeGuesses<rules>(hint, guesses);
+            }
+        }
+    }
+
+    // Return a string that identifies this state by its hint history,
+    // e.g. "raisey.gy.thumbyg..." - used as a key for caching.
+    std::string getKey() const
+    {
+        std::string key;
+        key.reserve(hints.size() * wordLen * 2);
+        for (auto&& hint : hints) {
+            key.append(std::string_view(hint.getGuess()));
+            if constexpr (fClassic) {
+                key.append(std::string_view(hint.getHint()));
+            } else {
+                key.append(Feedback::formatHint(hint.pattern));
+            }
+        }
+        return key;
+    }
+};
+
+// Make a GameState from a list of guess-hint pairs given as arguments.
+template<GuessRules rules, class Feedback = void>
+static GameState<rules, Feedback> makeGameState(const std::ranges::range auto& args)
+{
+    if ((std::ranges::distance(args) % 2) != 0) {
+        throwError("An even number of hint arguments is required.");
+    }
+    GameState<rules, Feedback> state;
+    if constexpr (!std::is_void_v<Feedback>) {
+        // The hints are given as for the feedback policy.
+        state.targets = wordList_t{ std::from_range, allTargets };
+        for (auto&& pair : args | std::views::chunk(2)) {
+            word_t guess;
+            checkWord(pair[0]);
+            copyWordFrom(guess, pair[0]);
+            state.addHint(FeedbackHint{ guess, Feedback::parseHint(pair[1]) });
+        }
+    } else {
+        state.hints = makeHints(args) | std::ranges::to<hintList_t>();
+        for (auto&& hint : state.hints) {
+            checkWildcards<rules>(hint);
+        }
+        if constexpr (rules == GuessRules::Consistent) {
+            state.targets = filterConsistent(state.hints, allTargets);
+        } else {
+            // Hints with wildcards can only be matched by filterConsistent().
+            hintList_t exactHints;
+            hintList_t wildHints;
+            for (auto&& hint : state.hints) {
+                (hint.hasWildcards() ? wildHints : exactHints).push_back(hint);
+            }
+            state.targets = filterConsistent(wildHints, filterTargets(exactHints, allTargets));
+        }
+        // In "hard mode" the list of guess words must be filtered by the
+        // hints seen so far.
+        if constexpr (rules != GuessRules::Any) {
+            state.guesses = getHardModeGuesses<rules>(state.hints);
+        }
+    }
+    if (state.targets.empty()) {
+        // Oops, no matching words at all!
+        throwError("No matching words found.");
+    }
+    return state;
+}
+
+// Make the starting GameState for --solve and --all.
+// This is the beginning of a game, or the state given by the --from option.
+template<GuessRules rules, class Feedback = void>
+static GameState<rules, Feedback> getStartState()
+{
+    auto args = CommandLine::GetFrom()
+        | std::views::split(' ')
+        | std::views::filter([](auto&& arg) { return !arg.empty(); })
+        | std::views::transform([](auto&& arg) { return std::string(std::string_view(arg)); })
+        | std::ranges::to<std::vector>();
+    return makeGameState<rules, Feedback>(args);
+}
+
+using score_t = unsigned long long;
+using guessScore_t = std::pair<word_t, score_t>;
+
+// Throw an error for invalid data in a results file.
+[[noreturn]] static void throwResultsError(std::string_view line)
+{
+    throwError(std::format("Bad results data: \"{}\"", line).c_str());
+}
+
+// Parse a line of a results file, e.g. "atlas, 3".
+static solution_t parseResultsLine(std::string_view line)
+{
+    if (line.ends_with('\r'))
+        line.remove_suffix(1);
+    auto pos = line.find(',');
+    if (pos == std::string::npos || pos < 5)
+        throwResultsError(line);
+    std::string_view word = line.substr(0, pos);
+    checkWord(word);
+    line.remove_prefix(6);
+    while (line.starts_with(' '))
+        line.remove_prefix(1);
+    unsigned num = numFromStr(line);
+    word_t wtemp;
+    copyWordFrom(wtemp, word);
+    return solution_t{ wtemp, num };
+}
+
+// Size of the pieces of a block that are parsed in parallel by forEachResult()
+static constexpr size_t parseChunkSize = 64 * 1024;
+
+// The results parsed from a piece of a results file, up to the first error
+struct ParsedResults
+{
+    std::vector<solution_t> results;
+    std::exception_ptr error;
+};
+
+// Parse the lines in a piece of a results file, which ends with a newline.
+static ParsedResults parseResultsLines(std::string_view lines)
+{
+    ParsedResults parsed;
+    try {
+        for (auto lineEnd = lines.find('\n'); lineEnd != std::string_view::npos;
+            lineEnd = lines.find('\n'))
+        {
+            parsed.results.push_back(parseResultsLine(lines.substr(0, lineEnd)));
+            lines.remove_prefix(lineEnd + 1);
+        }
+    } catch (...) {
+        // (An exception can't leave a parallel algorithm.)
+        parsed.error = std::current_exception();
+    }
+    return parsed;
+}
+
+// Call func with each solution_t in a results file (the output of --all), in
+// order. Use stdin if filename is empty.
+// The file is read a block at a time (see BlockReader), so it doesn't have to
+// fit in memory. The whole lines in each block are split into pieces that are
+// parsed in parallel, while the next blocks are being read.
+static void forEachResult(std::string_view filename, auto func)
+{
+    BlockReader reader(filename);
+    // The start of a line that continues in the next block
+    std::string partial;
+    std::vector<std::string_view> chunks;
+    std::vector<ParsedResults> parsed;
+    for (auto block = reader.next(); !block.empty(); block = reader.next()) {
+        std::string_view rest(block.data(), block.size());
+        if (!partial.empty()) {
+            // Finish the line from the last block.
+            auto lineEnd = rest.find('\n');
+            partial.append(rest.substr(0, lineEnd));
+            if (lineEnd == std::string_view::npos) {
+                continue;
+            }
+            func(parseResultsLine(partial));
+            partial.clear();
+            rest.remove_prefix(lineEnd + 1);
+        }
+        // Split the whole lines into pieces, and parse them.
+        auto lastEnd = rest.rfind('\n');
+        std::string_view lines = rest.substr(0, (lastEnd == std::string_view::npos) ? 0 : lastEnd + 1);
+        partial.assign(rest.substr(lines.size()));
+        chunks.clear();
+        while (!lines.empty()) {
+            size_t chunkEnd = lines.find('\n', std::min(parseChunkSize, lines.size()) - 1);
+            chunks.push_back(lines.substr(0, chunkEnd + 1));
+            lines.remove_prefix(chunkEnd + 1);
+        }
+        parsed.resize(chunks.size());
+        std::transform(std::execution::par, chunks.begin(), chunks.end(), parsed.begin(),
+            parseResultsLines);
+        for (auto&& chunk : parsed) {
+            for (auto&& result : chunk.results) {
+                func(result);
+            }
+            if (chunk.error) {
+                std::rethrow_exception(chunk.error);
+            }
+        }
+    }
+    if (!partial.empty()) {
+        func(parseResultsLine(partial));
+    }
+}
 
 // Load a list of solution_t from a results file (the output of --all).
 // Use stdin if filename is empty.
 static std::vector<solution_t> loadResultsFile(std::string_view filename)
 {
-    // Either open a file or use stdin.
-    bool inputFromStdin = false;
-    std::ifstream inFile;
-    if (filename.empty()) {
-        inputFromStdin = true;
-    } else {
-        inputFromStdin = false;
-        inFile.open(filename, std::ios::in);
-        if (inFile.fail()) {
-            throwError(std::format("Failed to open file {}", filename).c_str());
+    std::vector<solution_t> results;
+    forEachResult(filename, [&results](const solution_t& result) {
+        results.push_back(result);
+        });
+    return results;
+}
+
+// Ranking of guess words: how many times each word has been the best guess.
+// Words that have done well before are scored first by getNextGuessSub(),
+// which then lets it give up early on most of the other words.
+static std::map<word_t, unsigned>& guessRanking()
+{
+    static std::map<word_t, unsigned> ranking;
+    return ranking;
+}
+
+// Load the guess ranking from the file given by --ranking, if it exists.
+// The file has the same format as a results file: "word, count" lines.
+static void loadGuessRanking()
+{
+    const std::string& filename = CommandLine::GetRanking();
+    if (filename.empty() || !std::filesystem::exists(filename)) {
+        return;
+    }
+    auto& ranking = guessRanking();
+    for (auto&& [word, count] : loadResultsFile(filename)) {
+        ranking[word] += count;
+    }
+}
+
+// Save the guess ranking to the file given by --ranking, best guesses first.
+static void saveGuessRanking()
+{
+    const std::string& filename = CommandLine::GetRanking();
+    if (filename.empty()) {
+        return;
+    }
+    auto ranks = guessRanking() | std::ranges::to<std::vector<solution_t>>();
+    std::ranges::stable_sort(ranks, std::greater(), &solution_t::second);
+    std::ofstream outFile(filename, std::ios::out);
+    if (outFile.fail()) {
+        throwError(std::format("Failed to open file {}", filename).c_str());
+    }
+    for (auto&& [word, count] : ranks) {
+        outFile << std::format("{}, {}\n", std::string_view(word), count);
+    }
+    if (outFile.fail()) {
+        throwError(std::format("Failed to write file {}", filename).c_str());
+    }
+}
+
+// Shortlist of guess words for --shortlist: the best-ranked words in the
+// --ranking file, sorted. Empty if --shortlist isn't given.
+static std::vector<word_t>& guessShortlist()
+{
+    static std::vector<word_t> shortlist;
+    return shortlist;
+}
+
+// Make the --shortlist from the guess ranking. This is done when the ranking
+// is loaded, before anything else is learned.
+static void makeGuessShortlist()
+{
+    const unsigned size = CommandLine::GetShortlist();
+    if (size == 0) {
+        return;
+    }
+    auto ranks = guessRanking() | std::ranges::to<std::vector<solution_t>>();
+    if (ranks.empty()) {
+        throwError("--shortlist requires a --ranking file from earlier runs");
+    }
+    std::ranges::stable_sort(ranks, std::greater(), &solution_t::second);
+    auto& shortlist = guessShortlist();
+    shortlist = ranks
+        | std::views::take(size)
+        | std::views::keys
+        | std::ranges::to<std::vector>();
+    std::ranges::sort(shortlist);
+}
+
+// Return the words in a list of guess words that are on the shortlist.
+static wordList_t filterShortlist(const std::ranges::range auto& guessWords)
+{
+    const auto& shortlist = guessShortlist();
+    return guessWords
+        | std::views::filter([&shortlist](auto&& word) {
+            return std::ranges::binary_search(shortlist, word);
+            })
+        | std::ranges::to<wordList_t>();
+}
+
+#ifdef WORDLER_FIXED_CAPACITY
+// guessOrder_t is a list of indexes into a list of guess words
+using guessOrder_t = FixedVector<size_t, maxWords>;
+#else
+// guessOrder_t is a list of indexes into a list of guess words
+using guessOrder_t = std::vector<size_t>;
+#endif
+
+// Return the indexes of a list of guess words in the order they should be
+// scored: best-ranked words first, then the rest in their original order.
+static guessOrder_t rankGuesses(const std::ranges::random_access_range auto& guessWords)
+{
+    const auto& ranking = guessRanking();
+    guessOrder_t order;
+    order.reserve(std::ranges::size(guessWords));
+    // Ranked words first, sorted by rank
+    for (auto&& [index, word] : std::views::enumerate(guessWords)) {
+        if (ranking.contains(word)) {
+            order.push_back(size_t(index));
+        }
+    }
+    std::ranges::sort(order, [&](size_t a, size_t b) {
+        unsigned rankA = ranking.find(guessWords[a])->second;
+        unsigned rankB = ranking.find(guessWords[b])->second;
+        return (rankA != rankB) ? (rankA > rankB) : (a < b);
+        });
+    // Then the others
+    for (auto&& [index, word] : std::views::enumerate(guessWords)) {
+        if (!ranking.contains(word)) {
+            order.push_back(size_t(index));
+        }
+    }
+    return order;
+}
+
+// Score of a guess that hasn't been scored yet
+static constexpr guessScore_t worstGuess =
+    guessScore_t(nonWord(), std::numeric_limits<score_t>::max());
+
+// Packed pattern matrix
+// With a feedback policy, the first guess is chosen by scoring every guess
+// word against every target word, which works out each pattern again every
+// time. Building with WORDLER_PACKED_PATTERNS reads large lists of targets'
+// patterns from a table instead. The table is packed (see PackedByteRow)
+// because it is read from start to end for each guess: it takes 31MB, or
+// 44MB at one byte per pattern.
+
+// Minimum number of targets to score with the packed pattern matrix. Smaller
+// lists are quicker to score directly than by scanning whole rows.
+static constexpr size_t packedSweepSize = 512;
+
+// Return the index of a word's row in the packed pattern matrix: its index in
+// allTargets, or the number of targets plus its index in allGuesses.
+// Return nothing if it's in neither list.
+static std::optional<size_t> getPackedRowIndex(const word_t& word)
+{
+    if (auto found = std::ranges::lower_bound(allTargets, word);
+        found != std::end(allTargets) && *found == word)
+    {
+        return size_t(found - allTargets);
+    }
+    if (auto found = std::ranges::lower_bound(allGuesses, word);
+        found != std::end(allGuesses) && *found == word)
+    {
+        return std::size(allTargets) + size_t(found - allGuesses);
+    }
+    return std::nullopt;
+}
+
+// Return the packed pattern matrix for a feedback policy. Each row has the
+// patterns given by guessing its word (see getPackedRowIndex()) when each
+// word in allTargets in turn is the answer.
+template<class Feedback>
+static const std::vector<PackedByteRow>& getPackedPatternMatrix()
+{
+    static const std::vector<PackedByteRow> matrix = []() {
+        constexpr size_t numTargets = std::size(allTargets);
+        std::vector<PackedByteRow> m(numTargets + std::size(allGuesses));
+        std::vector<size_t> rows(m.size());
+        std::iota(rows.begin(), rows.end(), size_t(0));
+        std::for_each(std::execution::par, rows.begin(), rows.end(), [&m](size_t r) {
+            const word_t& guess = (r < numTargets) ? allTargets[r] : allGuesses[r - numTargets];
+            std::array<pattern_t, numTargets> patterns;
+            for (auto&& [pattern, target] : std::views::zip(patterns, allTargets)) {
+                pattern = Feedback::getPattern(target, guess);
+            }
+            m[r] = PackedByteRow(patterns);
+            });
+        return m;
+        }();
+    return matrix;
+}
+
+// Return a list of target words as a set of bits, one for each word in
+// allTargets, for PackedByteRow::countSelected().
+// Return nothing if any of them isn't in allTargets.
+static std::optional<std::vector<uint64_t>> getTargetSelection(
+    const std::ranges::range auto& targets)
+{
+    std::vector<uint64_t> selected((std::size(allTargets) + 63) / 64, 0);
+    for (auto&& target : targets) {
+        auto found = std::ranges::lower_bound(allTargets, target);
+        if (found == std::end(allTargets) || *found != target) {
+            return std::nullopt;
+        }
+        size_t i = size_t(found - allTargets);
+        selected[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    return selected;
+}
+
+// Score a guess the same way as scoreGuess(), using its row of the packed
+// pattern matrix. selected is the list of targets from getTargetSelection(),
+// and numSelected is the number of them.
+// The row is decoded all at once, and then the score is compared with the
+// best score. That gives the same result as scoreGuess() stopping early.
+template<class Feedback>
+static std::optional<score_t> scoreGuessPacked(size_t row,
+    std::span<const uint64_t> selected, size_t numSelected,
+    size_t index, score_t bestScore, size_t bestIndex)
+{
+    ++guessesScored();
+    const PackedByteRow& patterns = getPackedPatternMatrix<Feedback>()[row];
+    std::array<unsigned, Feedback::numPatterns> patternCounts{};
+    if (numSelected == patterns.size()) {
+        patterns.countAll(patternCounts);
+    } else {
+        patterns.countSelected(patternCounts, selected);
+    }
+    score_t score = 0;
+    for (unsigned n : patternCounts) {
+        score += score_t(n) * n;
+    }
+    if (score > bestScore || (score == bestScore && index > bestIndex)) {
+        return std::nullopt;
+    }
+    return score;
+}
+
+// Score a guess against a list of targets, based on how few matches it
+// allows over all possible correct answers (targets). Lower is better.
+// Helper routine for getNextGuessSub().
+// A guess's score only goes up as targets are added, so scoring stops and
+// returns nothing as soon as it can't beat the best score so far. Ties are won
+// by the guess that comes first in the list of guess words.
+template<class Feedback>
+static std::optional<score_t> scoreGuess(const word_t& guess, size_t index,
+    const std::ranges::random_access_range auto& targets,
+    score_t bestScore, size_t bestIndex)
+{
+    ++guessesScored();
+    // With a feedback policy, each target's pattern is counted. Each target
+    // adds 2n+1 to the score, where n is the number of targets already
+    // seen with the same pattern. That makes the total for n targets with
+    // the same pattern n*n, the same as counting the matches for each.
+    score_t score = 0;
+    std::array<unsigned, getNumPatterns<Feedback>()> patternCounts{};
+    for (auto&& target : targets) {
+        if constexpr (std::is_void_v<Feedback>) {
+            Hint hint = Hint::fromGuess(target, guess);
+            score += std::ranges::count_if(targets, [&hint](auto&& word) {
+                return hint.match(word);
+                });
+        } else {
+            score += 2 * patternCounts[Feedback::getPattern(target, guess)]++ + 1;
+        }
+        if (score > bestScore || (score == bestScore && index > bestIndex)) {
+            return std::nullopt;
+        }
+    }
+    return score;
+}
+
+// Evaluate all guesses against a list of targets and return the best guess.
+// Helper routine for getNextGuess().
+// If Feedback is a feedback policy, targets are grouped by the policy's hint
+// patterns instead of being matched with the Hint class.
+// If fLearn is false, the best guess isn't counted in the guess ranking, e.g.
+// when only the --shortlist is scored, so the ranking doesn't favour it.
+template<class Feedback = void>
+static guessScore_t getNextGuessSub(const std::ranges::random_access_range auto& targets,
+    const std::ranges::random_access_range auto& guessWords,
+    bool fLearn = true)
+{
+    // Check a couple of special cases.
+    if (targets.empty()) {
+        // Oops, no matching words at all!
+        throwError("No matching words found.");
+    } else if (targets.size() <= 2) {
+        // Only two possibilities remain - pick one.
+        // This prevents an extra roundabout guess when there are only 2 alternatives.
+        const word_t& guess = targets.front();
+        return { guess, 0 };
+    }
+
+    // Test all guess words, looking for the best one.
+    // A good guess is one that is expected to cut down the target list as much
+    // as possible.
+#ifndef RANGES_IMPL
+    // Implementation with loops
+    // The guesses are scored in ranked order (see rankGuesses()) so that a good
+    // score is found early, which lets scoreGuess() give up early on the rest.
+    // Ties are won by the guess that comes first in guessWords, so the result
+    // is the same as scoring every guess in order.
+    guessScore_t best = worstGuess;
+    size_t bestIndex = std::numeric_limits<size_t>::max();
+#ifdef WORDLER_PACKED_PATTERNS
+    // Score a large list of targets with the packed pattern matrix.
+    std::optional<std::vector<uint64_t>> selected;
+    if constexpr (!std::is_void_v<Feedback>) {
+        if (targets.size() >= packedSweepSize) {
+            selected = getTargetSelection(targets);
+        }
+    }
+#endif
+    for (size_t index : rankGuesses(guessWords)) {
+        const word_t& guess = guessWords[index];
+#ifdef WORDLER_PACKED_PATTERNS
+        if constexpr (!std::is_void_v<Feedback>) {
+            if (std::optional<size_t> row = selected ? getPackedRowIndex(guess) : std::nullopt) {
+                if (auto score = scoreGuessPacked<Feedback>(*row, *selected, targets.size(),
+                    index, best.second, bestIndex))
+                {
+                    best = guessScore_t(guess, *score);
+                    bestIndex = index;
+                }
+                continue;
+            }
+        }
+#endif
+        if (auto score = scoreGuess<Feedback>(guess, index, targets, best.second, bestIndex)) {
+            best = guessScore_t(guess, *score);
+            bestIndex = index;
+        }
+    }
+#ifndef WORDLER_FIXED_CAPACITY
+    // Learn the ranking. (Not with a fixed capacity because adding a word to
+    // the ranking uses the heap.)
+    if (fLearn && bestIndex < std::ranges::size(guessWords)) {
+        ++guessRanking()[best.first];
+    }
+#endif
+#else
+    // Implementation with ranges and algorithms
+    // (no faster but certainly uglier, and doesn't stop early)
+    static_assert(std::is_void_v<Feedback>, "Feedback policies need the loop implementation");
+    // Compute numeric scores for all possible guesses.
+    auto guessScores = guessWords
+        | std::views::transform([&targets](auto&& guess) {
+        auto scores = targets
+            | std::views::transform([&targets, &guess](auto&& target) {
+                Hint hint = Hint::fromGuess(target, guess);
+                return std::ranges::count_if(targets, [&hint](auto&& word) {
+                    return hint.match(word);
+                    });
+                });
+        score_t score = std::accumulate(scores.begin(), scores.end(), 0ull);
+        return guessScore_t(guess, score);
+            });
+    // Choose the guess with the best (lowest) score.
+    guessScore_t best =
+        std::accumulate(guessScores.begin(), guessScores.end(), worstGuess,
+            [](auto&& min, auto&& next) {
+                return (next.second < min.second) ? next : min;
+            });
+#endif
+
+    return best;
+}
+
+// Evaluate all guesses against each of several lists of targets and return the
+// best guess for each list, the same as getNextGuessSub() would.
+// Each guess is scored against all of the lists before going on to the next
+// guess, so a whole level of the search is done in one pass over the guess
+// words, and the ranking is only worked out once.
+template<class Feedback = void>
+static std::vector<guessScore_t> getNextGuessBatch(
+    std::span<const wordList_t* const> targetLists,
+    const std::ranges::random_access_range auto& guessWords,
+    bool fLearn = true)
+{
+    std::vector<guessScore_t> best(targetLists.size(), worstGuess);
+#ifndef RANGES_IMPL
+    std::vector<size_t> bestIndex(targetLists.size(), std::numeric_limits<size_t>::max());
+    // getNextGuessSub() handles the special cases. The rest are scored here.
+    std::vector<size_t> toScore;
+    for (auto&& [i, targets] : std::views::enumerate(targetLists)) {
+        if (targets->size() <= 2) {
+            best[i] = getNextGuessSub<Feedback>(*targets, guessWords);
+        } else {
+            toScore.push_back(size_t(i));
+        }
+    }
+    for (size_t index : rankGuesses(guessWords)) {
+        const word_t& guess = guessWords[index];
+        for (size_t i : toScore) {
+            if (auto score = scoreGuess<Feedback>(guess, index, *targetLists[i],
+                best[i].second, bestIndex[i]))
+            {
+                best[i] = guessScore_t(guess, *score);
+                bestIndex[i] = index;
+            }
+        }
+    }
+#ifndef WORDLER_FIXED_CAPACITY
+    // Learn the ranking. (Not for a list that had no guess to score.)
+    if (fLearn) {
+        for (size_t i : toScore) {
+            if (bestIndex[i] < std::ranges::size(guessWords)) {
+                ++guessRanking()[best[i].first];
+            }
+        }
+    }
+#endif
+#else
+    for (auto&& [i, targets] : std::views::enumerate(targetLists)) {
+        best[i] = getNextGuessSub<Feedback>(*targets, guessWords, fLearn);
+    }
+#endif
+    return best;
+}
+
+// Choose between guess1, the best guess that could possibly be a correct
+// answer, and guess2, the best guess of any valid word.
+static const guessScore_t& chooseGuess(const guessScore_t& guess1,
+    const guessScore_t& guess2)
+{
+    if (guess2.second == std::numeric_limits<score_t>::max()) {
+        // There were no words to score for guess2 (e.g. none on the shortlist).
+        return guess1;
+    }
+    // Compare scores of guess1 and guess2, giving a slight preference to a
+    // guess that could fortuitously be the correct answer.
+    static constexpr double preference = 1.1;
+    return (guess1.second <= score_t(preference * guess2.second + 1))
+        ? guess1 : guess2;
+}
+
+// Choose the best word to guess next, given that the correct answer is in a
+// list of target words.
+// With --shortlist, only the guess words on the shortlist are tried (as well
+// as the targets), and they aren't counted in the guess ranking.
+template<class Feedback = void>
+static word_t getNextGuess(const std::ranges::range auto& targets,
+    const std::ranges::range auto& guessWords)
+{
+    guessScore_t guess1 = getNextGuessSub<Feedback>(targets, targets);
+    guessScore_t guess2 = guessShortlist().empty()
+        ? getNextGuessSub<Feedback>(targets, guessWords)
+        : getNextGuessSub<Feedback>(targets, filterShortlist(guessWords), false);
+    return chooseGuess(guess1, guess2).first;
+}
+
+// Choose the best word to guess next for each of several lists of targets,
+// the same as getNextGuess() would, using getNextGuessBatch().
+template<class Feedback = void>
+static std::vector<word_t> getNextGuesses(std::span<const wordList_t* const> targetLists,
+    const std::ranges::random_access_range auto& guessWords)
+{
+    std::vector<guessScore_t> guesses2 = guessShortlist().empty()
+        ? getNextGuessBatch<Feedback>(targetLists, guessWords)
+        : getNextGuessBatch<Feedback>(targetLists, filterShortlist(guessWords), false);
+    std::vector<word_t> guesses;
+    for (auto&& [targets, guess2] : std::views::zip(targetLists, guesses2)) {
+        guessScore_t guess1 = getNextGuessSub<Feedback>(*targets, *targets);
+        guesses.push_back(chooseGuess(guess1, guess2).first);
+    }
+    return guesses;
+}
+
+// Endgame table entry: the optimal guess for a set of possible answers, and
+// the total number of guesses needed to solve every answer in the set.
+// If the answers can't all be solved in the guesses left, the guess is
+// nonWord() and the total is the maximum.
+struct EndgameEntry
+{
+    word_t guess;
+    score_t totalGuesses;
+};
+
+// endgameSet_t is a set of possible answers in the endgame table, in
+// allTargets order
+using endgameSet_t = std::vector<word_t>;
+
+// Number of guesses left for an endgame in hard mode, which allows enough
+// guesses that the endgame never runs out
+static constexpr unsigned endgameNoLimit = std::numeric_limits<unsigned>::max();
+
+// Endgame table key: a set of possible answers and the number of guesses left
+// to solve them in. Targets can be any list of words, so that the table can be
+// searched with a wordList_t.
+template<class Targets>
+struct EndgameKey
+{
+    unsigned guessesLeft;
+    Targets targets;
+};
+
+// Comparison for endgame table keys of any type
+struct EndgameKeyLess
+{
+    using is_transparent = void;
+
+    bool operator()(const auto& a, const auto& b) const
+    {
+        if (a.guessesLeft != b.guessesLeft) {
+            return a.guessesLeft < b.guessesLeft;
+        }
+        return std::ranges::lexicographical_compare(a.targets, b.targets);
+    }
+};
+
+// Endgame table: optimal guesses for small sets of possible answers, built by
+// buildEndgameTable().
+using endgameTable_t = std::map<EndgameKey<endgameSet_t>, EndgameEntry, EndgameKeyLess>;
+
+// Return the number of guesses left for the endgame in a game state.
+template<GuessRules rules>
+static unsigned getEndgameGuessesLeft(const GameState<rules>& state)
+{
+    if constexpr (rules != GuessRules::Any) {
+        return endgameNoLimit;
+    } else {
+        return (state.hints.size() < maxGuesses) ? maxGuesses - unsigned(state.hints.size()) : 0;
+    }
+}
+
+static endgameTable_t& endgameTable()
+{
+    static endgameTable_t table;
+    return table;
+}
+
+// Find the optimal guess for a small set of possible answers by searching all
+// the ways to play it out in the guesses left. The results for the set and all
+// the smaller sets it is divided into are stored in table.
+// The cost of a guess is the total number of guesses needed to solve every
+// answer, i.e. the expected number of guesses times the number of answers.
+// Lines of play that need more than the guesses left are ruled out, so the
+// result may cost more than the unlimited optimum, or be impossible.
+// In hard mode only the answers themselves are tried as guesses, since they
+// are the only words sure to be allowed in every line of play.
+template<GuessRules rules>
+static EndgameEntry solveEndgame(const endgameSet_t& targets, unsigned guessesLeft,
+    endgameTable_t& table)
+{
+    auto found = table.find(EndgameKey<const endgameSet_t&>{ guessesLeft, targets });
+    if (found != table.end()) {
+        return found->second;
+    }
+    const score_t numTargets = targets.size();
+    const unsigned childGuessesLeft =
+        (guessesLeft == endgameNoLimit) ? endgameNoLimit : guessesLeft - 1;
+    EndgameEntry best{ nonWord(), std::numeric_limits<score_t>::max() };
+    if (guessesLeft == 0 || (guessesLeft == 1 && numTargets > 1)) {
+        // Impossible - leave best as it is.
+    } else if (numTargets <= 2) {
+        // Guess one; if it's wrong the other one is the answer.
+        best = EndgameEntry{ targets.front(), 2 * numTargets - 1 };
+    } else {
+        auto tryGuess = [&](const word_t& guess) {
+            // Divide the answers into groups that give the same hint.
+            std::map<word_t, endgameSet_t> groups;
+            for (auto&& target : targets) {
+                groups[Hint::fromGuess(target, guess).getHint()].push_back(target);
+            }
+            if (groups.size() == 1 && !std::ranges::contains(targets, guess)) {
+                // This guess doesn't tell us anything.
+                return;
+            }
+            // Each answer takes this guess, plus the guesses to solve its group.
+            // Every group of n answers needs at least 2n-1 more guesses, which
+            // rules out most guesses before any groups are solved.
+            static constexpr word_t allGreen = { 'g', 'g', 'g', 'g', 'g' };
+            groups.erase(allGreen);
+            score_t total = numTargets;
+            for (auto&& group : groups | std::views::values) {
+                total += 2 * group.size() - 1;
+            }
+            if (total >= best.totalGuesses) {
+                return;
+            }
+            total = numTargets;
+            for (auto&& group : groups | std::views::values) {
+                EndgameEntry entry = solveEndgame<rules>(group, childGuessesLeft, table);
+                if (entry.guess == nonWord()) {
+                    // Some answers can't be solved in time.
+                    return;
+                }
+                total += entry.totalGuesses;
+                if (total >= best.totalGuesses) {
+                    return;
+                }
+            }
+            best = EndgameEntry{ guess, total };
+            };
+        // Try the possible answers first - they're likely to be good.
+        for (auto&& guess : targets) {
+            tryGuess(guess);
+        }
+        // Then the other answer words, which are often good probes, and the
+        // words that are never answers. (allGuesses doesn't include the
+        // answer words.)
+        if constexpr (rules == GuessRules::Any) {
+            for (auto&& guess : allTargets) {
+                if (!std::ranges::contains(targets, guess)) {
+                    tryGuess(guess);
+                }
+            }
+            for (auto&& guess : allGuesses) {
+                tryGuess(guess);
+            }
+        }
+    }
+    table.emplace(EndgameKey<endgameSet_t>{ guessesLeft, targets }, best);
+    return best;
+}
+
+// Forward declaration
+template<GuessRules rules, class Feedback>
+static word_t getNextGuessCached(const GameState<rules, Feedback>& state);
+
+// Find the sets of --endgame or fewer possible answers that can be reached
+// from a game state by following the strategy, with the guesses left for them.
+template<GuessRules rules>
+static void findEndgameStates(const GameState<rules>& state,
+    std::vector<EndgameKey<endgameSet_t>>& found)
+{
+    if (state.targets.size() <= CommandLine::GetEndgame()) {
+        found.push_back(EndgameKey<endgameSet_t>{ getEndgameGuessesLeft(state),
+            endgameSet_t{ std::from_range, state.targets } });
+        return;
+    }
+    if (getEndgameGuessesLeft(state) == 0) {
+        return;
+    }
+    word_t guess = getNextGuessCached(state);
+    std::map<word_t, unsigned> hints;
+    for (auto&& target : state.targets) {
+        if (std::string_view(target) != std::string_view(guess)) {
+            ++hints[Hint::fromGuess(target, guess).getHint()];
+        }
+    }
+    for (auto&& hint : hints | std::views::keys) {
+        // (A GameState can be large, so keep it off the stack.)
+        auto next = std::make_unique<GameState<rules>>(state);
+        next->addHint(Hint(guess, hint));
+        findEndgameStates(*next, found);
+    }
+}
+
+// Build the endgame table for all the small sets of possible answers that the
+// strategy can reach from the given states, if --endgame is given.
+// The sets are solved in parallel.
+template<GuessRules rules>
+static void buildEndgameTable(std::span<const GameState<rules>> startStates)
+{
+    if (CommandLine::GetEndgame() == 0) {
+        return;
+    }
+    std::vector<EndgameKey<endgameSet_t>> endgames;
+    for (auto&& startState : startStates) {
+        findEndgameStates(startState, endgames);
+    }
+    auto sameKey = [](auto&& a, auto&& b) {
+        return a.guessesLeft == b.guessesLeft && a.targets == b.targets;
+        };
+    std::ranges::sort(endgames, EndgameKeyLess());
+    auto [uniqueBegin, uniqueEnd] = std::ranges::unique(endgames, sameKey);
+    endgames.erase(uniqueBegin, uniqueEnd);
+    // Each set is solved into its own table, then they're all merged.
+    std::vector<endgameTable_t> tables(endgames.size());
+    std::vector<size_t> indexes(endgames.size());
+    std::iota(indexes.begin(), indexes.end(), size_t(0));
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+        [&endgames, &tables](size_t i) {
+            solveEndgame<rules>(endgames[i].targets, endgames[i].guessesLeft, tables[i]);
+        });
+    for (auto&& table : tables) {
+        endgameTable().merge(table);
+    }
+}
+
+template<GuessRules rules>
+static void buildEndgameTable(const GameState<rules>& startState)
+{
+    buildEndgameTable(std::span<const GameState<rules>>(&startState, 1));
+}
+
+// The strategy: the guesses chosen for all the game states seen so far,
+// keyed by the states' hint histories (see GameState::getKey()). Each
+// feedback policy has its own.
+template<class Feedback = void>
+static std::unordered_map<std::string, word_t>& strategyCache()
+{
+    static std::unordered_map<std::string, word_t> cache;
+    return cache;
+}
+
+// Return the next guess for a game state if it's known without scoring any
+// guesses: the only possible answer, the first guess, or the guess from the
+// endgame table.
+// (The endgame table is only for the classic hints.)
+template<GuessRules rules, class Feedback>
+static std::optional<word_t> getKnownGuess(const GameState<rules, Feedback>& state)
+{
+    if (state.targets.size() == 1) {
+        // Only one possibility left, this should be the answer.
+        return state.targets.front();
+    } else if (state.hints.empty() && hasFirstGuess()) {
+        // Use the default first guess.
+        return getFirstGuess();
+    }
+    if constexpr (std::is_void_v<Feedback>) {
+        if (auto endgame = endgameTable().find(
+            EndgameKey<const wordList_t&>{ getEndgameGuessesLeft(state), state.targets });
+            endgame != endgameTable().end() && endgame->second.guess != nonWord())
+        {
+            // Use the optimal guess from the endgame table.
+            return endgame->second.guess;
+        }
+    }
+    return std::nullopt;
+}
+
+// Choose the next guess for a game state, remembering the choice.
+// getNextGuess() always gives the same answer for the same state, so when
+// many games are solved (e.g. --all) each state only has to be computed once.
+template<GuessRules rules, class Feedback>
+static word_t getNextGuessCached(const GameState<rules, Feedback>& state)
+{
+    auto& cache = strategyCache<Feedback>();
+    std::string key = state.getKey();
+    auto found = cache.find(key);
+    if (found != cache.end()) {
+        return found->second;
+    }
+    std::optional<word_t> known = getKnownGuess(state);
+    word_t guess = known ? *known : getNextGuess<Feedback>(state.targets, state.getGuesses());
+    cache.emplace(std::move(key), guess);
+    return guess;
+}
+
+// Work out the strategy for all the game states that can follow startState,
+// one level (number of guesses) at a time, and put it in the strategy cache.
+// All the states at a level that need getNextGuess() are done in one pass by
+// getNextGuesses().
+// This is only done in normal mode, because in hard mode each state has its
+// own guess words, and not with a fixed capacity, because a level can have
+// thousands of states. Otherwise the strategy is worked out as needed.
+template<GuessRules rules, class Feedback>
+static void precomputeStrategy([[maybe_unused]] const GameState<rules, Feedback>& startState)
+{
+#ifndef WORDLER_FIXED_CAPACITY
+    if constexpr (rules == GuessRules::Any) {
+        using state_t = GameState<rules, Feedback>;
+        auto& cache = strategyCache<Feedback>();
+        std::vector<state_t> level{ startState };
+        while (!level.empty()) {
+            // Score the states that need it.
+            std::vector<const state_t*> toScore;
+            for (auto&& state : level) {
+                if (!cache.contains(state.getKey()) && !getKnownGuess(state)) {
+                    toScore.push_back(&state);
+                }
+            }
+            auto targetLists = toScore
+                | std::views::transform([](const state_t* state) { return &state->targets; })
+                | std::ranges::to<std::vector<const wordList_t*>>();
+            std::vector<word_t> guesses = getNextGuesses<Feedback>(targetLists, allGuesses);
+            for (auto&& [state, guess] : std::views::zip(toScore, guesses)) {
+                cache.emplace(state->getKey(), guess);
+            }
+            // Find the states at the next level: one for each different hint
+            // that the guess can give, unless the guess is right.
+            std::vector<state_t> next;
+            for (auto&& state : level) {
+                word_t guess = getNextGuessCached(state);
+                std::set<pattern_t> patterns;
+                for (auto&& target : state.targets) {
+                    if (target == guess) {
+                        continue;
+                    }
+                    auto hint = makeHint<Feedback>(target, guess);
+                    if (patterns.insert(hint.getPattern()).second) {
+                        state_t& nextState = next.emplace_back(state);
+                        nextState.addHint(hint);
+                    }
+                }
+            }
+            level = std::move(next);
+        }
+    }
+#endif
+}
+
+// Solve for a given target word by calling getNextGuess() repeatedly,
+// starting from the given game state.
+// The number of guesses returned includes the guesses already in startState.
+template<GuessRules rules, class Feedback>
+static solution_t solveWord(const word_t& target,
+    const GameState<rules, Feedback>& startState,
+    bool fPrintGuesses)
+{
+    if (!std::ranges::contains(startState.targets, target)) {
+        throwError(std::format("Answer \"{}\" does not match the starting hints.",
+            std::string_view(target)).c_str());
+    }
+    GameState<rules, Feedback> state = startState;
+    // Make guesses to refine the targets list until the answer is found
+    // or all guesses are used up.
+    // For "hard mode", allow more guesses because it's not guaranteed to
+    // succeed every time.
+    constexpr unsigned maxGuessesT = getMaxGuesses<rules, Feedback>();
+    for (unsigned i = unsigned(state.hints.size()); i < maxGuessesT; ++i) {
+        word_t guess = getNextGuessCached(state);
+        if (fPrintGuesses) {
+            lvprint("Guess #{} is ", i + 1);
+            lprintln("\"{}\"", std::string_view(guess));
+        }
+        // Is this the correct answer?
+        if (std::string_view(guess) == std::string_view(target)) {
+            // Return the answer and the number of guesses.
+            return { guess, i + 1 };
+        }
+        // Filter the targets list according to the latest guess.
+        state.addHint(makeHint<Feedback>(target, guess));
+        if (state.targets.empty()) {
+            // Oops, no matching words at all!
+            throwError("No matching words found.");
+        }
+    }
+    throwError(std::format("Answer \"{}\" was not found in {} tries.",
+        std::string_view(target), maxGuessesT).c_str());
+}
+
+// Display the word to guess next, based on the hints given on thte command line.
+template<GuessRules rules, class Feedback = void>
+static void doNextGuess(auto args)
+{
+    if (args.empty() && hasFirstGuess() ) {
+        // Use the default first guess.
+        lprintln("First guess is \"{}\"", std::string_view(getFirstGuess()));
+    } else {
+        // The command line args are the hints given so far.
+        word_t guess = nonWord();
+        // Find a good next guess. Show how long it takes.
+        double t = runTime([&]() {
+            GameState<rules, Feedback> state;
+            runPhase("filter", [&]() { state = makeGameState<rules, Feedback>(args); });
+            runPhase("score", [&]() {
+                guess = getNextGuess<Feedback>(state.targets, state.getGuesses());
+                });
+            });
+        lvprintln("Time: {:.02f} seconds", t);
+        lprintln("Best guess is \"{}\"", std::string_view(guess));
+    }
+}
+
+// Answer queries from stdin, one per line, so that a client can play a game
+// without sending the whole hint history every time. A query is a state
+// token, optionally followed by the guess made in that state and its hint:
+//     <token> [<guess> <hint>]
+// The reply is the next guess and the token for the new state:
+//     <guess> <token>
+// or "error <message>". Token 0 is the starting state (see --from).
+// Each new state is made by filtering its parent state's targets and guesses
+// by the new hint, and a state that was seen before gets the same token.
+// Up to --query-states states are kept, including token 0. Before a new
+// state is added, the least recently used one is forgotten if there are
+// already that many (except token 0), and its token is unknown from then on.
+template<GuessRules rules>
+static void doQuery()
+{
+    // A remembered state. In hard mode, its guess words are kept as a set of
+    // bits rather than a list, which is a fraction of the size, and the list
+    // is made again when the state is used.
+    struct QueryState
+    {
+        GameState<rules> state;
+        std::conditional_t<rules == GuessRules::Any, std::monostate, guessBits_t> guessBits;
+        std::list<size_t>::iterator lruPos;
+    };
+    auto storeState = [](const GameState<rules>& state, std::list<size_t>::iterator lruPos) {
+        QueryState stored{ GameState<rules>{ state.hints, state.targets, {} }, {}, lruPos };
+        if constexpr (rules != GuessRules::Any) {
+            const word_t* pos = std::begin(allGuesses);
+            for (auto&& word : state.guesses) {
+                pos = std::lower_bound(pos, std::end(allGuesses), word);
+                stored.guessBits.set(size_t(pos - std::begin(allGuesses)));
+            }
+        }
+        return stored;
+        };
+    auto loadState = [](const QueryState& stored) {
+        GameState<rules> state = stored.state;
+        if constexpr (rules != GuessRules::Any) {
+            state.guesses.reserve(stored.guessBits.count());
+            for (size_t i = 0; i < stored.guessBits.size(); ++i) {
+                if (stored.guessBits.test(i)) {
+                    state.guesses.push_back(allGuesses[i]);
+                }
+            }
+        }
+        return state;
+        };
+    if (CommandLine::GetQueryStates() < 2) {
+        throwError("--query-states must be at least 2");
+    }
+    const size_t maxStates = CommandLine::GetQueryStates();
+    std::unordered_map<size_t, QueryState> states;
+    std::unordered_map<std::string, size_t> tokens;
+    std::list<size_t> lru;  // tokens other than 0, most recently used first
+    size_t nextToken = 1;
+    GameState<rules> startState = getStartState<rules>();
+    tokens.emplace(startState.getKey(), 0);
+    buildEndgameTable(startState);
+    states.emplace(0, storeState(startState, lru.end()));
+    // Return the state for a token, marking it as the most recently used.
+    auto findState = [&](size_t token) -> QueryState& {
+        auto found = states.find(token);
+        if (found == states.end()) {
+            throwError(std::format("Unknown token: {}", token).c_str());
+        }
+        if (token != 0) {
+            lru.splice(lru.begin(), lru, found->second.lruPos);
+        }
+        return found->second;
+        };
+    // Answer one query.
+    auto answer = [&](std::string_view query) -> std::string {
+        try {
+            auto args = query
+                | std::views::split(' ')
+                | std::views::filter([](auto&& arg) { return !arg.empty(); })
+                | std::views::transform([](auto&& arg) { return std::string_view(arg); })
+                | std::ranges::to<std::vector>();
+            if (args.size() != 1 && args.size() != 3) {
+                throwError("Expected a token, optionally followed by a guess and a hint");
+            }
+            size_t token = numFromStr(args[0]);
+            GameState<rules> state = loadState(findState(token));
+            if (args.size() == 3) {
+                state.addHint(Hint(args[1], args[2]));
+                if (state.targets.empty()) {
+                    throwError("No matching words found.");
+                }
+                std::string key = state.getKey();
+                if (auto found = tokens.find(key); found != tokens.end()) {
+                    // (It's the same state, so only its place in the LRU order changes.)
+                    token = found->second;
+                    findState(token);
+                } else {
+                    if (states.size() >= maxStates) {
+                        // Forget the least recently used state.
+                        auto forgotten = states.find(lru.back());
+                        tokens.erase(forgotten->second.state.getKey());
+                        states.erase(forgotten);
+                        lru.pop_back();
+                    }
+                    token = nextToken++;
+                    lru.push_front(token);
+                    tokens.emplace(std::move(key), token);
+                    states.emplace(token, storeState(state, lru.begin()));
+                }
+            }
+            word_t guess = getNextGuessCached(state);
+            return std::format("{} {}", std::string_view(guess), token);
+        } catch (const std::exception& e) {
+            return std::format("error {}", e.what());
+        }
+        };
+    if (!CommandLine::GetShm().empty()) {
+        // Take queries from a shared memory channel, from one client at a
+        // time, until a client sends "quit". Each query is read in place.
+        ShmConnection channel = ShmConnection::create(CommandLine::GetShm());
+        bool fQuit = false;
+        while (!fQuit) {
+            fQuit = channel->requests.pop([&](std::string_view query) {
+                if (query == "quit") {
+                    return true;
+                }
+                // (An error message can quote the query, and push() can't
+                // send a reply that doesn't fit in a message.)
+                std::string reply = answer(query);
+                if (reply.size() > ShmMessage::maxSize) {
+                    reply = "error Reply too long";
+                }
+                channel->responses.push(reply);
+                return false;
+                });
+        }
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            std::println("{}", answer(line));
+            std::fflush(stdout);
+        }
+    }
+}
+
+// Read a guess word from an input stream. Repeat until a valid guess is entered.
+static std::optional<word_t> getInputGuess(std::istream& input,
+    unsigned i,
+    const std::ranges::range auto& guessWords)
+{
+    for (;;) {
+        std::string sWord;
+        lvprint("Guess #{}: ", i);
+        if (!std::getline(input, sWord)) {
+            // input error or EOF
+            return std::nullopt;
+        }
+        if (sWord.length() == wordLen) {
+            // Kludgy way to check if guess is a valid guess word
+            word_t word;
+            copyWordFrom(word, sWord);
+            Hint hint = Hint::fromGuess(word, word);
+            wordList_t matches = filterTargets(hint, guessWords);
+            if (std::size(matches) == 1
+                && std::string_view(matches.front()) == sWord)
+            {
+                return word;
+            }
+        }
+        std::println("Invalid guess - try again");
+    }
+}
+
+// Play a game
+template<GuessRules rules>
+static void doPlayGame(auto args)
+{
+    word_t answer = getRandomTarget();
+    wordList_t guesses{ std::from_range, allGuesses };
+    hintList_t hints;
+    for (unsigned i = 1; i <= maxGuesses; ++i) {
+        auto guessOpt = getInputGuess(std::cin, i, guesses);
+        if (!guessOpt) {
+            // Error, or gave up
+            return;
+        }
+        word_t guess = guessOpt.value();
+        if (std::string_view(guess) == std::string_view(answer)) {
+            // Done!
+            lvprintln("Correct! Answer \"{}\" was found in {} tries.",
+                std::string_view(answer), i);
+            return;
+        }
+        Hint hint = Hint::fromGuess(answer, guess);
+        lprintln("          {}", std::string_view(hint.getHint()));
+        hints.push_back(hint);
+        if constexpr (rules != GuessRules::Any) {
+            guesses = getHardModeGuesses<rules>(hints);
+        }
+    }
+    lvprintln("Answer \"{}\" was not found in {} tries.",
+        std::string_view(answer), maxGuesses);
+}
+
+// Show the solution for the target word given on the command line.
+template<GuessRules rules, class Feedback = void>
+static void doSolve(auto args)
+{
+    // Play games automatically with given target words.
+    GameState<rules, Feedback> startState = getStartState<rules, Feedback>();
+    if constexpr (std::is_void_v<Feedback>) {
+        runPhase("endgame", [&]() { buildEndgameTable(startState); });
+    }
+    for (auto&& arg : args) {
+        word_t target;
+        checkWord(arg);
+        copyWordFrom(target, arg);
+        lvprintln("Target: \"{}\"", std::string_view(target));
+        solution_t s;
+        double t = runTime([&]() {
+            runPhase("solve", [&]() { s = solveWord(target, startState, true); });
+            });
+        lvprintln("Time: {:.02f} seconds", t);
+        lvprint("Answer: \"{}\" in ", std::string_view(s.first));
+        lprintln("{} tries", s.second);
+    }
+}
+
+// Forward declaration
+static void printStats(const std::vector<solution_t>& results);
+
+// Call func with the feedback policy selected by --feedback as its template
+// argument.
+static void withFeedback(auto func)
+{
+    std::string_view name = CommandLine::GetFeedback();
+    if (name == WordleFeedback::name) {
+        func.template operator()<WordleFeedback>();
+    } else if (name == PeaksFeedback::name) {
+        func.template operator()<PeaksFeedback>();
+    } else if (name == MastermindFeedback::name) {
+        func.template operator()<MastermindFeedback>();
+    } else {
+        throwError(std::format("Unknown --feedback: {}", name).c_str());
+    }
+}
+
+// Strategy improvement (--improve)
+// The strategy is a tree of game states, each with the guess to make there.
+// Its cost is counted for the answers that actually reach each state, i.e.
+// the answers that would give exactly the state's hints. (A state's targets
+// can include a few more words, because Hint::match() is looser than that.)
+
+// Cost of a subtree of the strategy: the total number of guesses to solve
+// all the answers that reach its root state, and the most guesses that any of
+// them takes, counted from the root state.
+struct SubtreeCost
+{
+    score_t totalGuesses = 0;
+    unsigned maxGuesses = 0;
+};
+
+// A state on the strategy tree, identified by its key (see
+// GameState::getKey()), and the answers that reach it
+struct StrategyNode
+{
+    std::string key;
+    std::vector<word_t> reached;
+};
+
+// Split a list of answers by the hint a guess gives for each one, leaving out
+// the answer that is the guess itself.
+static std::map<pattern_t, std::pair<Hint, std::vector<word_t>>> splitByHint(
+    const std::vector<word_t>& reached, const word_t& guess)
+{
+    std::map<pattern_t, std::pair<Hint, std::vector<word_t>>> groups;
+    for (auto&& target : reached) {
+        if (target != guess) {
+            Hint hint = Hint::fromGuess(target, guess);
+            auto [group, fNew] = groups.try_emplace(hint.getPattern(), hint, std::vector<word_t>{});
+            group->second.second.push_back(target);
+        }
+    }
+    return groups;
+}
+
+// Clock for the --improve time limit
+using improveClock = std::chrono::steady_clock;
+
+template<GuessRules rules>
+static std::optional<SubtreeCost> getStrategyCost(const GameState<rules>& state,
+    const std::vector<word_t>& reached,
+    std::unordered_map<std::string, SubtreeCost>& costs,
+    improveClock::time_point deadline);
+
+// Return the cost of guessing the given word in a game state and then
+// following the strategy. Return nothing if some answer is never solved, or
+// if the deadline passes first.
+template<GuessRules rules>
+static std::optional<SubtreeCost> getGuessCost(const GameState<rules>& state,
+    const std::vector<word_t>& reached, const word_t& guess,
+    std::unordered_map<std::string, SubtreeCost>& costs,
+    improveClock::time_point deadline)
+{
+    // Each answer takes this guess, and then the guesses in its group's subtree.
+    SubtreeCost cost{ reached.size(), 1 };
+    for (auto&& [hint, groupReached] : splitByHint(reached, guess) | std::views::values) {
+        if (groupReached.size() == reached.size()) {
+            // The guess doesn't tell the answers apart, so this goes nowhere.
+            return std::nullopt;
+        }
+        // (A GameState can be large, so keep it off the stack.)
+        auto next = std::make_unique<GameState<rules>>(state);
+        next->addHint(hint);
+        std::optional<SubtreeCost> groupCost = getStrategyCost(*next, groupReached, costs, deadline);
+        if (!groupCost) {
+            return std::nullopt;
+        }
+        cost.totalGuesses += groupCost->totalGuesses;
+        cost.maxGuesses = std::max(cost.maxGuesses, groupCost->maxGuesses + 1);
+    }
+    return cost;
+}
+
+// Return the cost of following the strategy from a game state, or nothing if
+// some answer is never solved or the deadline passes first. Costs are
+// memoized in costs, by state key.
+// (Working out a guess for a state that isn't in the strategy cache can take
+// a while, so the deadline is checked for every state.)
+template<GuessRules rules>
+static std::optional<SubtreeCost> getStrategyCost(const GameState<rules>& state,
+    const std::vector<word_t>& reached,
+    std::unordered_map<std::string, SubtreeCost>& costs,
+    improveClock::time_point deadline)
+{
+    std::string key = state.getKey();
+    if (auto found = costs.find(key); found != costs.end()) {
+        return found->second;
+    }
+    if (state.hints.size() >= maxGuessesHard || improveClock::now() >= deadline) {
+        return std::nullopt;
+    }
+    std::optional<SubtreeCost> cost = getGuessCost(state, reached, getNextGuessCached(state),
+        costs, deadline);
+    if (cost) {
+        costs.emplace(std::move(key), *cost);
+    }
+    return cost;
+}
+
+// Return a lower bound for the total cost of guessing a word: each answer
+// takes this guess, and a group of n answers left after it takes at least
+// 2n-1 more guesses (at best, one of them is guessed right next time and the
+// rest take two or more).
+static score_t getGuessCostBound(const std::vector<word_t>& reached, const word_t& guess)
+{
+    std::array<unsigned, WordleFeedback::numPatterns> counts{};
+    for (auto&& target : reached) {
+        if (target != guess) {
+            ++counts[Hint::fromGuess(target, guess).getPattern()];
+        }
+    }
+    score_t bound = reached.size();
+    for (unsigned n : counts) {
+        if (n > 0) {
+            bound += 2 * n - 1;
+        }
+    }
+    return bound;
+}
+
+// Add the states on the strategy tree from a game state to a list.
+template<GuessRules rules>
+static void findStrategyNodes(const GameState<rules>& state,
+    const std::vector<word_t>& reached, std::vector<StrategyNode>& nodes)
+{
+    nodes.push_back(StrategyNode{ state.getKey(), reached });
+    if (reached.size() <= 1 || state.hints.size() >= maxGuessesHard) {
+        return;
+    }
+    for (auto&& [hint, groupReached] : splitByHint(reached, getNextGuessCached(state)) | std::views::values) {
+        auto next = std::make_unique<GameState<rules>>(state);
+        next->addHint(hint);
+        findStrategyNodes(*next, groupReached, nodes);
+    }
+}
+
+// Return the game state reached from startState by the hints in a key (see
+// GameState::getKey()).
+template<GuessRules rules>
+static std::unique_ptr<GameState<rules>> getStateFromKey(const GameState<rules>& startState,
+    std::string_view key)
+{
+    auto state = std::make_unique<GameState<rules>>(startState);
+    key.remove_prefix(startState.getKey().size());
+    for (; !key.empty(); key.remove_prefix(2 * wordLen)) {
+        state->addHint(Hint(key.substr(0, wordLen), key.substr(wordLen, wordLen)));
+    }
+    return state;
+}
+
+// Is the state with the given key on the strategy tree from the state with
+// startKey, i.e. is each of its guesses the strategy's guess in the state
+// before it?
+static bool isOnStrategy(std::string_view startKey, std::string_view key)
+{
+    const auto& cache = strategyCache();
+    for (size_t pos = startKey.size(); pos < key.size(); pos += 2 * wordLen) {
+        auto found = cache.find(std::string(key.substr(0, pos)));
+        if (found == cache.end()
+            || std::string_view(found->second) != key.substr(pos, wordLen))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Maximum number of other guesses to try in each state
+static constexpr size_t improveMaxTries = 10;
+
+// Improve the strategy from startState by local search, for up to --improve
+// seconds, and return the number of states whose guess was changed.
+// The states on the strategy tree are visited in order of how many answers
+// reach them, skipping the ones that are no longer on the tree because a
+// guess before them was changed. In each one, the guesses whose lower bound (see
+// getGuessCostBound()) beats the current cost are tried, best bound first,
+// and one is kept if it lowers the total number of guesses without taking too
+// many guesses for any answer. The bounds are computed in parallel. Trying a
+// guess only works out the cost of its own subtrees, because the costs of the
+// rest of the tree are memoized.
+template<GuessRules rules>
+static unsigned improveStrategy(const GameState<rules>& startState)
+{
+    const improveClock::time_point deadline =
+        improveClock::now() + std::chrono::seconds(CommandLine::GetImprove());
+    const std::string startKey = startState.getKey();
+    constexpr unsigned maxGuessesT = getMaxGuesses<rules>();
+    auto& cache = strategyCache();
+    std::unordered_map<std::string, SubtreeCost> costs;
+    std::vector<StrategyNode> nodes;
+    findStrategyNodes(startState, startState.targets | std::ranges::to<std::vector>(), nodes);
+    std::ranges::stable_sort(nodes, std::greater(),
+        [](const StrategyNode& node) { return node.reached.size(); });
+    std::vector<std::string> changed;
+    for (auto&& node : nodes) {
+        if (improveClock::now() >= deadline) {
+            break;
+        }
+        if (node.reached.size() <= 1 || !isOnStrategy(startKey, node.key)) {
+            continue;
+        }
+        auto state = getStateFromKey(startState, node.key);
+        std::optional<SubtreeCost> current = getStrategyCost(*state, node.reached, costs, deadline);
+        if (!current) {
+            continue;
+        }
+        // The guesses to try are the answers that reach this state and the
+        // other words that may be guessed here.
+        std::vector<word_t> candidates = node.reached;
+        candidates.append_range(state->getGuesses());
+        using bound_t = std::pair<score_t, word_t>;
+        std::vector<bound_t> bounds(candidates.size());
+        std::transform(std::execution::par, candidates.begin(), candidates.end(), bounds.begin(),
+            [&node](const word_t& guess) {
+                return bound_t{ getGuessCostBound(node.reached, guess), guess };
+            });
+        std::erase_if(bounds, [&current](const bound_t& bound) {
+            return bound.first >= current->totalGuesses;
+            });
+        std::ranges::sort(bounds);
+        const word_t oldGuess = cache.at(node.key);
+        for (auto&& guess : bounds | std::views::take(improveMaxTries) | std::views::values) {
+            if (improveClock::now() >= deadline) {
+                break;
+            }
+            if (guess == oldGuess) {
+                continue;
+            }
+            std::optional<SubtreeCost> cost = getGuessCost(*state, node.reached, guess,
+                costs, deadline);
+            if (cost && cost->totalGuesses < current->totalGuesses
+                && state->hints.size() + cost->maxGuesses <= maxGuessesT)
+            {
+                cache[node.key] = guess;
+                current = cost;
+                changed.push_back(node.key);
+                // The costs of this state and the states before it have changed.
+                std::erase_if(costs, [&node](auto&& entry) {
+                    return node.key.starts_with(entry.first);
+                    });
+                costs.emplace(node.key, *cost);
+            }
+        }
+    }
+    // Only count the changes that are still on the strategy tree. (A state
+    // visited after one of its ancestors was changed is skipped, so this is
+    // only a safeguard.)
+    return unsigned(std::ranges::count_if(changed, [&startKey](const std::string& key) {
+        return isOnStrategy(startKey, key);
+        }));
+}
+
+// Solve for _all_ target words. Print the number of guesses required for each
+// word.
+// If --from is given, solve all the target words that match those hints
+// and also print the distribution of guess counts.
+// If --improve is given, improve the strategy first and compare the results
+// with a results file.
+// (The endgame table and --improve are only for the classic hints.)
+template<GuessRules rules, class Feedback = void>
+static void doSolveAll(auto args)
+{
+    GameState<rules, Feedback> startState = getStartState<rules, Feedback>();
+    if constexpr (std::is_void_v<Feedback>) {
+        runPhase("endgame", [&]() { buildEndgameTable(startState); });
+    }
+    runPhase("strategy", [&]() { precomputeStrategy(startState); });
+    unsigned numImproved = 0;
+    if constexpr (std::is_void_v<Feedback>) {
+        if (CommandLine::GetImprove()) {
+            runPhase("improve", [&]() { numImproved = improveStrategy(startState); });
         }
     }
-    std::istream& input = inputFromStdin ? std::cin : inFile;
-    // Read and parse the file.
     std::vector<solution_t> results;
-    std::string lineStr;
-    while (std::getline(input, lineStr)) {
-        // Each line has a guess word and a number, e.g. "atlas, 3"
-        std::string_view line = lineStr;
-        auto pos = line.find(',');
-        if (pos == std::string::npos || pos < 5)
-            throwResultsError(line);
-        std::string_view word = line.substr(0, pos);
-        checkWord(word);
-        line.remove_prefix(6);
-        while (line.starts_with(' '))
-            line.remove_prefix(1);
-        unsigned num = numFromStr(line);
-        word_t wtemp;
-        copyWordFrom(wtemp, word);
-        results.push_back(solution_t{ wtemp, num });
+    runPhase("solve", [&]() {
+        for (auto&& target : startState.targets) {
+            solution_t s = solveWord(target, startState, false);
+            std::println("{}, {}", std::string_view(s.first), s.second);
+            std::cout.flush();
+            results.push_back(s);
+        }
+        });
+    if (!startState.hints.empty()) {
+        printStats(results);
     }
-    return results;
+    if (CommandLine::GetImprove()) {
+        // Compare with the results file, for the answers in both.
+        std::string_view filename = args.empty() ? "results.txt"sv : std::string_view(args[0]);
+        std::map<word_t, unsigned> before = loadResultsFile(filename) | std::ranges::to<std::map>();
+        unsigned long count = 0;
+        unsigned long totalBefore = 0;
+        unsigned long totalAfter = 0;
+        for (auto&& [target, guesses] : results) {
+            if (auto found = before.find(target); found != before.end()) {
+                ++count;
+                totalBefore += found->second;
+                totalAfter += guesses;
+            }
+        }
+        std::println("Improved the guess in {} states", numImproved);
+        if (count > 0) {
+            std::println("Mean guesses: {:.4f} in {}, {:.4f} now ({:+.4f})",
+                double(totalBefore) / count, filename, double(totalAfter) / count,
+                (double(totalAfter) - double(totalBefore)) / count);
+        }
+    }
+}
+
+// Measure how much --shortlist changes the guesses, for each game state in
+// the strategy tree after the first guess: how often the guess is different
+// from the best guess, and how much worse its score is.
+// The tree is the one without --shortlist, i.e. each state's hints follow the
+// best guesses. It starts with the usual first guess (e.g. --init), which
+// isn't checked. States with two targets or fewer aren't counted, because no
+// words are scored for them.
+// None of this is counted in the guess ranking.
+template<GuessRules rules>
+static void doVerifyShortlist()
+{
+    if (guessShortlist().empty()) {
+        throwError("--verify requires --shortlist");
+    }
+    GameState<rules> startState = getStartState<rules>();
+    // Return the best guess for a state without and with the shortlist.
+    auto getGuesses = [](const GameState<rules>& state) {
+        guessScore_t guess1 = getNextGuessSub(state.targets, state.targets, false);
+        guessScore_t guess2 = getNextGuessSub(state.targets, state.getGuesses(), false);
+        guessScore_t guess2Short = getNextGuessSub(state.targets,
+            filterShortlist(state.getGuesses()), false);
+        return std::pair(chooseGuess(guess1, guess2), chooseGuess(guess1, guess2Short));
+        };
+    unsigned numStates = 0;
+    unsigned numDifferent = 0;
+    unsigned numWorse = 0;
+    double totalIncrease = 0.0;
+    double maxIncrease = 0.0;
+    std::string maxState;
+    runPhase("verify", [&]() {
+        // Walk the tree depth first.
+        std::vector<GameState<rules>> todo;
+        // Add the states after each hint a guess can give, except the one
+        // that solves it.
+        auto addNextStates = [&todo](const GameState<rules>& state, const word_t& guess) {
+            std::map<pattern_t, Hint> hints;
+            for (auto&& target : state.targets) {
+                if (target != guess) {
+                    Hint hint = Hint::fromGuess(target, guess);
+                    hints.emplace(hint.getPattern(), hint);
+                }
+            }
+            for (auto&& hint : hints | std::views::values) {
+                GameState<rules> next = state;
+                next.addHint(hint);
+                todo.push_back(std::move(next));
+            }
+            };
+        addNextStates(startState, getNextGuessCached(startState));
+        while (!todo.empty()) {
+            GameState<rules> state = std::move(todo.back());
+            todo.pop_back();
+            if (state.targets.size() <= 2) {
+                // getNextGuessSub() doesn't score any words.
+                continue;
+            }
+            auto [best, shortlisted] = getGuesses(state);
+            ++numStates;
+            if (shortlisted.first != best.first) {
+                ++numDifferent;
+            }
+            if (shortlisted.second > best.second) {
+                ++numWorse;
+                double increase = 100.0 * (double(shortlisted.second) / double(best.second) - 1.0);
+                totalIncrease += increase;
+                if (increase > maxIncrease) {
+                    maxIncrease = increase;
+                    maxState = state.getKey();
+                }
+            }
+            addNextStates(state, best.first);
+        }
+        });
+    std::println("Shortlist: {} words", guessShortlist().size());
+    std::println("Game states checked: {}", numStates);
+    if (numStates == 0) {
+        return;
+    }
+    std::println("Different guess: {} ({:.1f}%)",
+        numDifferent, 100.0 * numDifferent / numStates);
+    std::println("Worse guess: {} ({:.1f}%)",
+        numWorse, 100.0 * numWorse / numStates);
+    std::println("Mean score increase: {:.2f}%", totalIncrease / numStates);
+    if (numWorse > 0) {
+        std::println("Max score increase: {:.2f}% after \"{}\"", maxIncrease, maxState);
+    }
+}
+
+// Distributed --all: a coordinator process hands out the answers to solve,
+// one at a time, to worker processes that connect to it over TCP. A worker
+// that gets easy answers just asks for more. The protocol is lines of text:
+//     coordinator: <config>            (on connecting - see getWorkConfig())
+//     coordinator: solve <answer>      (a work unit)
+//     worker:      alive               (heartbeat, all the time)
+//     worker:      solved <answer> <number of guesses>
+//     worker:      failed <answer> <error message>
+//     coordinator: done                (when all the answers are finished)
+// If a worker disconnects or is silent for too long, its answer is handed out
+// again. An answer that fails isn't handed out again, because it would fail
+// the same way on every worker.
+
+// Time between a worker's heartbeats
+static constexpr int workHeartbeatMs = 2000;
+
+// Time after which a silent worker is presumed lost
+static constexpr int workTimeoutMs = 10000;
+
+// Return a description of the options that affect solving, which the
+// coordinator and its workers must agree on.
+// The --shortlist is described by its size and a checksum of its words,
+// because it depends on the --ranking file too.
+template<GuessRules rules>
+static std::string getWorkConfig()
+{
+    // (FNV-1a hash)
+    uint64_t shortlistHash = 14695981039346656037ull;
+    for (auto&& word : guessShortlist()) {
+        for (char ch : word) {
+            shortlistHash = (shortlistHash ^ uint8_t(ch)) * 1099511628211ull;
+        }
+    }
+    return std::format("wordler-work 2 {} init={} from={} endgame={} shortlist={}:{:016x}",
+        getRulesName(rules), CommandLine::GetInit(), CommandLine::GetFrom(),
+        CommandLine::GetEndgame(), guessShortlist().size(), shortlistHash);
+}
+
+// The coordinator's work units, shared by its connection threads
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<word_t> todo;            // answers to hand out
+    std::map<word_t, unsigned> results; // number of guesses for each answer
+    std::map<word_t, std::string> failures; // error message for each answer
+    size_t total = 0;                   // number of answers to solve
+
+    bool isFinished(const word_t& answer) const
+    {
+        return results.contains(answer) || failures.contains(answer);
+    }
+
+    bool isDone() const
+    {
+        return results.size() + failures.size() == total;
+    }
+};
+
+// Hand out work units to one worker until all the answers are solved or the
+// worker is lost. (Runs in its own thread.)
+static void serveWorker(TcpSocket conn, WorkQueue& work, const std::string& config)
+{
+    std::optional<word_t> target;
+    try {
+        conn.sendLine(config);
+        for (;;) {
+            // Get an answer that isn't finished yet. (One that was handed out
+            // again might have been finished by its first worker after all.)
+            {
+                std::unique_lock lock(work.mutex);
+                while (!target && !work.isDone()) {
+                    if (work.todo.empty()) {
+                        work.changed.wait(lock);
+                    } else {
+                        word_t next = work.todo.front();
+                        work.todo.pop_front();
+                        if (!work.isFinished(next)) {
+                            target = next;
+                        }
+                    }
+                }
+            }
+            if (!target) {
+                break;
+            }
+            conn.sendLine(std::format("solve {}", std::string_view(*target)));
+            // Wait for the result.
+            std::optional<unsigned> guesses;
+            std::optional<std::string> failure;
+            const std::string solvedPrefix = std::format("solved {} ", std::string_view(*target));
+            const std::string failedPrefix = std::format("failed {} ", std::string_view(*target));
+            while (!guesses && !failure) {
+                std::optional<std::string> line = conn.receiveLine(workTimeoutMs);
+                if (!line) {
+                    throwError("Worker lost");
+                } else if (line->starts_with(solvedPrefix)) {
+                    guesses = numFromStr(std::string_view(*line).substr(solvedPrefix.size()));
+                } else if (line->starts_with(failedPrefix)) {
+                    failure = line->substr(failedPrefix.size());
+                } else if (*line != "alive") {
+                    throwError("Bad message from worker");
+                }
+            }
+            {
+                std::lock_guard lock(work.mutex);
+                if (guesses) {
+                    work.results.emplace(*target, *guesses);
+                } else {
+                    work.failures.emplace(*target, std::move(*failure));
+                }
+                target.reset();
+            }
+            work.changed.notify_all();
+        }
+        conn.sendLine("done");
+    } catch (const std::exception&) {
+        // The worker is lost. Hand out its answer again.
+        if (target) {
+            {
+                std::lock_guard lock(work.mutex);
+                work.todo.push_back(*target);
+            }
+            work.changed.notify_all();
+        }
+    }
+}
+
+// Solve all target words like doSolveAll(), but using worker processes that
+// connect on the --coordinate port.
+template<GuessRules rules>
+static void doCoordinate()
+{
+    GameState<rules> startState = getStartState<rules>();
+    WorkQueue work;
+    work.todo.append_range(startState.targets);
+    work.total = startState.targets.size();
+    const std::string config = getWorkConfig<rules>();
+    TcpSocket listener = TcpSocket::listen(uint16_t(CommandLine::GetCoordinate()));
+    runPhase("solve", [&]() {
+        std::vector<std::jthread> workers;
+        for (;;) {
+            {
+                std::lock_guard lock(work.mutex);
+                if (work.isDone()) {
+                    break;
+                }
+            }
+            if (std::optional<TcpSocket> conn = listener.accept(1000)) {
+                workers.emplace_back(serveWorker, std::move(*conn), std::ref(work), std::cref(config));
+            }
+        }
+        });
+    // Display the merged results in the same order as doSolveAll(), which
+    // stops at an answer that fails.
+    std::vector<solution_t> results;
+    for (auto&& target : startState.targets) {
+        if (auto failed = work.failures.find(target); failed != work.failures.end()) {
+            throwError(failed->second.c_str());
+        }
+        solution_t s{ target, work.results[target] };
+        std::println("{}, {}", std::string_view(s.first), s.second);
+        results.push_back(s);
+    }
+    if (!startState.hints.empty()) {
+        printStats(results);
+    }
+}
+
+// Solve the answers handed out by the coordinator at the --worker address.
+template<GuessRules rules>
+static void doWorker()
+{
+    std::string_view address = CommandLine::GetWorker();
+    size_t colon = address.rfind(':');
+    if (colon == std::string_view::npos) {
+        throwError(std::format("Bad --worker address: \"{}\"", address).c_str());
+    }
+    unsigned port = numFromStr(address.substr(colon + 1));
+    GameState<rules> startState = getStartState<rules>();
+    buildEndgameTable(startState);
+    TcpSocket conn = TcpSocket::connect(std::string(address.substr(0, colon)), uint16_t(port));
+    std::optional<std::string> config = conn.receiveLine(-1);
+    if (config != getWorkConfig<rules>()) {
+        throwError("The coordinator's options don't match this worker's options");
+    }
+    // Send heartbeats from another thread, all the time. (The coordinator only
+    // checks for them while it waits for a result.)
+    std::mutex sendMutex;
+    auto send = [&](std::string_view line) {
+        std::lock_guard lock(sendMutex);
+        conn.sendLine(line);
+        };
+    std::jthread heartbeat([&send](std::stop_token stop) {
+        std::mutex waitMutex;
+        std::condition_variable_any wake;
+        std::unique_lock lock(waitMutex);
+        while (!wake.wait_for(lock, stop, std::chrono::milliseconds(workHeartbeatMs),
+            []() { return false; }) && !stop.stop_requested())
+        {
+            try {
+                send("alive");
+            } catch (const std::exception&) {
+                return;
+            }
+        }
+        });
+    for (;;) {
+        std::optional<std::string> line = conn.receiveLine(-1);
+        if (!line) {
+            throwError("Lost the connection to the coordinator");
+        } else if (*line == "done") {
+            break;
+        } else if (!line->starts_with("solve ")) {
+            throwError("Bad message from the coordinator");
+        }
+        std::string_view answer = std::string_view(*line).substr(6);
+        checkWord(answer);
+        word_t target;
+        copyWordFrom(target, answer);
+        // Report an answer that can't be solved to the coordinator, rather
+        // than exiting so that it hands the answer to the next worker.
+        try {
+            solution_t s = solveWord(target, startState, false);
+            send(std::format("solved {} {}", std::string_view(s.first), s.second));
+        } catch (const std::runtime_error& e) {
+            send(std::format("failed {} {}", answer, e.what()));
+        }
+    }
+}
+
+// targetBits_t is a set of target words: bit i is allTargets[i]
+using targetBits_t = RankSelectBits<std::size(allTargets)>;
+
+// Return the table of hint patterns given by each target word as a guess
+// when each target word is the answer. The pattern for guessing allTargets[g]
+// when the answer is allTargets[a] is at [g * std::size(allTargets) + a].
+static const std::vector<pattern_t>& getTargetPatternTable()
+{
+    static const std::vector<pattern_t> table = []() {
+        constexpr size_t numTargets = std::size(allTargets);
+        std::vector<pattern_t> t(numTargets * numTargets);
+        std::vector<size_t> guesses(numTargets);
+        std::iota(guesses.begin(), guesses.end(), size_t(0));
+        std::for_each(std::execution::par, guesses.begin(), guesses.end(), [&t](size_t guess) {
+            for (size_t answer = 0; answer < numTargets; ++answer) {
+                t[guess * numTargets + answer] =
+                    Hint::fromGuess(allTargets[answer], allTargets[guess]).getPattern();
+            }
+            });
+        return t;
+        }();
+    return table;
+}
+
+// Simulate games played by a baseline player who guesses a random word from
+// the words that could be the answer, starting from the --from hints, and
+// display the stats. Each possible answer is played in turn.
+// The possible answers are kept in a bitset, so a random one can be picked
+// with select() instead of making a list of them for each guess.
+static void doRandomPlayer()
+{
+    constexpr size_t numTargets = std::size(allTargets);
+    GameState<GuessRules::Any> startState = getStartState<GuessRules::Any>();
+    const std::vector<pattern_t>& table = getTargetPatternTable();
+    targetBits_t startTargets;
+    for (auto&& target : startState.targets) {
+        startTargets.set(size_t(std::ranges::lower_bound(allTargets, target) - allTargets));
+    }
+    startTargets.buildIndex();
+    std::vector<size_t> answers;
+    for (size_t i = 0; i < numTargets; ++i) {
+        if (startTargets.test(i)) {
+            answers.push_back(i);
+        }
+    }
+    if (answers.empty()) {
+        throwError("No matching words found.");
+    }
+    // Play the games in parallel, in chunks with their own random numbers and
+    // histogram of guess counts.
+    const unsigned numGames = CommandLine::GetRandom();
+    constexpr unsigned numChunks = 256;
+    std::vector<std::vector<unsigned long>> histos(numChunks);
+    std::vector<unsigned> chunks(numChunks);
+    std::iota(chunks.begin(), chunks.end(), 0u);
+    runPhase("random", [&]() {
+        std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](unsigned chunk) {
+            std::mt19937 rng(chunk);
+            std::vector<unsigned long>& histo = histos[chunk];
+            for (unsigned game = chunk; game < numGames; game += numChunks) {
+                size_t answer = answers[game % answers.size()];
+                targetBits_t targets = startTargets;
+                unsigned guesses = unsigned(startState.hints.size());
+                for (;;) {
+                    ++guesses;
+                    std::uniform_int_distribution<size_t> pick(0, targets.count() - 1);
+                    size_t guess = targets.select(pick(rng));
+                    if (guess == answer) {
+                        break;
+                    }
+                    const pattern_t* row = &table[guess * numTargets];
+                    pattern_t pattern = row[answer];
+                    targets.keepIf([row, pattern](size_t i) { return row[i] == pattern; });
+                }
+                if (histo.size() <= guesses) {
+                    histo.resize(guesses + 1, 0);
+                }
+                ++histo[guesses];
+            }
+            });
+        });
+    // Combine the chunks' histograms and display the stats.
+    std::vector<unsigned long> histo;
+    for (auto&& chunkHisto : histos) {
+        if (histo.size() < chunkHisto.size()) {
+            histo.resize(chunkHisto.size(), 0);
+        }
+        for (auto&& [i, count] : std::views::enumerate(chunkHisto)) {
+            histo[i] += count;
+        }
+    }
+    unsigned long totalGuesses = 0;
+    unsigned long numSolved = 0;
+    for (auto&& [i, count] : std::views::enumerate(histo)) {
+        totalGuesses += count * (unsigned long)i;
+        if (size_t(i) <= maxGuesses) {
+            numSolved += count;
+        }
+    }
+    std::println("Number of games: {}", numGames);
+    if (numGames == 0) {
+        return;
+    }
+    std::println("Mean guesses: {:.2f}", double(totalGuesses) / double(numGames));
+    std::println("Solved in {} guesses: {:.2f}%",
+        maxGuesses, 100.0 * double(numSolved) / double(numGames));
+    std::println("Histogram stats:");
+    for (auto&& [i, count] : std::views::enumerate(histo)) {
+        std::println("{}, {}", i, count);
+    }
+}
+
+// Number of answers solved by --compare before it can stop early
+static constexpr unsigned compareMinAnswers = 30;
+
+// Width of --compare's confidence interval, in standard errors. This is wider
+// than the usual 1.96 (95%) because the interval is checked after every
+// answer, which would otherwise make a mistaken early stop more likely.
+static constexpr double compareZ = 3.0;
+
+// Difference in mean guesses that's too small to matter for --compare
+static constexpr double compareTolerance = 0.01;
+
+// Compare two strategies by solving the same random answers with both of
+// them: the normal strategy (A), and guessing the --compare word next and
+// then using the normal strategy (B). Using the same answers for both makes
+// the difference between them much less noisy. Solving stops as soon as the
+// confidence interval of the difference shows that one strategy is better
+// or that the difference is too small to matter, or when all the possible
+// answers have been solved.
+template<GuessRules rules>
+static void doCompare()
+{
+    GameState<rules> startState = getStartState<rules>();
+    word_t guessA = getNextGuessCached(startState);
+    word_t guessB;
+    checkWord(CommandLine::GetCompare());
+    copyWordFrom(guessB, CommandLine::GetCompare());
+    // (In hard mode, the words that could be the answer can be guessed, as
+    // well as the allowed guess words. Otherwise any word can be guessed.)
+    bool fAllowed = std::ranges::contains(startState.getGuesses(), guessB)
+        || ((rules == GuessRules::Any)
+            ? std::ranges::contains(allTargets, guessB)
+            : std::ranges::contains(startState.targets, guessB));
+    if (!fAllowed) {
+        throwError(std::format("\"{}\" can't be guessed now", std::string_view(guessB)).c_str());
+    }
+    // The endgame table covers the states that both strategies can reach:
+    // the states after guessB are followed by the solver's strategy.
+    std::vector<GameState<rules>> endgameStates{ startState };
+    std::set<pattern_t> patternsB;
+    for (auto&& target : startState.targets) {
+        Hint hint = Hint::fromGuess(target, guessB);
+        if (target != guessB && patternsB.insert(hint.getPattern()).second) {
+            endgameStates.push_back(startState);
+            endgameStates.back().addHint(hint);
+        }
+    }
+    runPhase("endgame", [&]() { buildEndgameTable<rules>(endgameStates); });
+    endgameStates.clear();
+    wordList_t answers = startState.targets;
+    std::mt19937 randGen(1);
+    std::ranges::shuffle(answers, randGen);
+    // Running mean and variance of the differences in number of guesses
+    // (using Welford's method)
+    // An answer that a strategy fails to solve counts as one guess more than
+    // the most allowed.
+    constexpr unsigned failedGuesses = getMaxGuesses<rules>() + 1;
+    auto solveOrFail = [](const word_t& target, const GameState<rules>& state) {
+        try {
+            return solveWord(target, state, false).second;
+        } catch (const std::runtime_error&) {
+            return failedGuesses;
+        }
+        };
+    unsigned numSolved = 0;
+    unsigned numFailedA = 0;
+    unsigned numFailedB = 0;
+    unsigned long totalA = 0;
+    unsigned long totalB = 0;
+    double mean = 0.0;
+    double sumSquares = 0.0;
+    double halfWidth = std::numeric_limits<double>::infinity();
+    runPhase("compare", [&]() {
+        for (auto&& target : answers) {
+            unsigned guessesA = solveOrFail(target, startState);
+            unsigned guessesB = unsigned(startState.hints.size()) + 1;
+            if (target != guessB) {
+                GameState<rules> stateB = startState;
+                stateB.addHint(Hint::fromGuess(target, guessB));
+                guessesB = solveOrFail(target, stateB);
+            }
+            numFailedA += (guessesA == failedGuesses);
+            numFailedB += (guessesB == failedGuesses);
+            totalA += guessesA;
+            totalB += guessesB;
+            ++numSolved;
+            double diff = double(guessesA) - double(guessesB);
+            double delta = diff - mean;
+            mean += delta / numSolved;
+            sumSquares += delta * (diff - mean);
+            if (numSolved >= compareMinAnswers) {
+                // The differences are whole numbers of guesses, so if they have
+                // all been the same, the next one could still be different.
+                // The variance is at least what it would be if one of them
+                // had been one guess different, so that this doesn't stop
+                // early with a zero-width interval.
+                double variance = std::max(sumSquares / (numSolved - 1), 1.0 / numSolved);
+                halfWidth = compareZ * std::sqrt(variance / numSolved);
+                if (std::abs(mean) > halfWidth || halfWidth < compareTolerance) {
+                    break;
+                }
+            }
+        }
+        });
+    std::println("Answers solved: {} of {}", numSolved, answers.size());
+    std::println("Mean guesses: {:.3f} for \"{}\", {:.3f} for \"{}\"",
+        double(totalA) / numSolved, std::string_view(guessA),
+        double(totalB) / numSolved, std::string_view(guessB));
+    if (numFailedA > 0 || numFailedB > 0) {
+        std::println("Failed: {} for \"{}\", {} for \"{}\" (counted as {} guesses)",
+            numFailedA, std::string_view(guessA), numFailedB, std::string_view(guessB),
+            failedGuesses);
+    }
+    if (numSolved < compareMinAnswers) {
+        std::println("Not enough answers to compare");
+    } else {
+        std::println("Difference: {:+.3f} +/- {:.3f}", mean, halfWidth);
+        if (std::abs(mean) > halfWidth) {
+            std::println("\"{}\" is better", std::string_view((mean < 0) ? guessA : guessB));
+        } else {
+            std::println("No clear difference");
+        }
+    }
+    // Each answer not solved saves a game with each strategy.
+    size_t numSaved = 2 * (answers.size() - numSolved);
+    std::println("Games saved: {} of {} ({:.0f}%)", numSaved, 2 * answers.size(),
+        100.0 * double(numSaved) / double(2 * answers.size()));
 }
 
-// Stats helper struct for std::accumulate
+// Statistics for a list of results, added one at a time
 struct Stats
 {
     unsigned long count = 0;
     unsigned long totalGuesses = 0;
     solution_t min = { nonWord(), 99};
     solution_t max = { nonWord(), 0};
+    // Number of results for each number of guesses
+    std::vector<unsigned long> histo;
+
+    void add(const solution_t& result)
+    {
+        ++count;
+        totalGuesses += result.second;
+        if (result.second < min.second) {
+            min = result;
+        }
+        if (result.second > max.second) {
+            max = result;
+        }
+        if (histo.size() <= result.second) {
+            histo.resize(result.second + 1, 0);
+        }
+        ++histo[result.second];
+    }
 };
 
-// Display statistics for the results produced by --all.
-// Filename is given on the command line, defaults to stdin.
-static void doShowStats(auto args)
+// Display statistics for a list of results.
+static void printStats(const Stats& stats)
 {
-    // Load the results file, from either stdin or a given filename.
-    std::string_view filename = ""sv;
-    if (args.size() >= 1) {
-        filename = args[0];
+    std::println("Number of results: {}", stats.count);
+    if (stats.count == 0) {
+        return;
     }
-    auto results = loadResultsFile(filename);
-    std::println("Number of results: {}", results.size());
-    // Use std::accumulate to calculate statistics.
-    Stats stats = std::accumulate(results.begin(), results.end(), Stats{},
-        [](const Stats& accum, const solution_t next) -> Stats {
-            return Stats{
-                .count = accum.count + 1,
-                .totalGuesses = accum.totalGuesses + next.second,
-                .min = (next.second < accum.min.second) ? next : accum.min,
-                .max = (next.second > accum.max.second) ? next : accum.max
-            };
-        });
     std::println("Min guesses: {} for \"{}\"",
         stats.min.second, std::string_view(stats.min.first));
     std::println("Max guesses: {} for e.g. \"{}\"",
@@ -698,14 +3278,131 @@ static void doShowStats(auto args)
     std::println("Mean guesses: {:.2f}",
         double(stats.totalGuesses) / double(stats.count));
     std::println("Histogram stats:");
-    std::vector<unsigned> histo;
-    histo.resize(stats.max.second + 1, 0);
+    for (auto&& [i, count] : std::views::enumerate(stats.histo)) {
+        std::println("{}, {}", i, count);
+    }
+}
+
+static void printStats(const std::vector<solution_t>& results)
+{
+    Stats stats;
     for (auto&& result : results) {
-        ++histo[result.second];
+        stats.add(result);
     }
-    for (auto&& [i, count] : std::views::enumerate(histo)) {
-        std::println("{}, {}", i, count);
+    printStats(stats);
+}
+
+// Display statistics for the results produced by --all.
+// Filename is given on the command line, defaults to stdin.
+static void doShowStats(auto args)
+{
+    // Load the results file, from either stdin or a given filename.
+    std::string_view filename = ""sv;
+    if (args.size() >= 1) {
+        filename = args[0];
+    }
+    // The results are added up as they're read, so the file can be huge.
+    Stats stats;
+    forEachResult(filename, [&stats](const solution_t& result) { stats.add(result); });
+    printStats(stats);
+}
+
+// Export the most-visited game states of the strategy to a file, so that a
+// client can look up most moves itself and only ask for the rest.
+// The states are weighted by how often each answer occurs, as given in an
+// optional frequency file (same format as a results file), or equally.
+// The file is limited to --max-size bytes, in this format:
+//     wordler-strategy 1 <mode>        (header - version and hard mode rules)
+//     <guess> <hint history>           (one line per state, most visited first)
+//     ?                                (any other state is not covered)
+// where the hint history is the guess and hint of each previous turn, run
+// together (e.g. "raisey.gy."), and is empty for the first guess, and mode is
+// normal, hard, official or consistent.
+template<GuessRules rules>
+static void doExport(auto args)
+{
+    if (args.size() < 1 || args.size() > 2) {
+        throwError("Requires 1 or 2 args");
+    }
+    std::string filename = args[0];
+    // Get the weight of each answer word.
+    GameState<rules> startState = getStartState<rules>();
+    std::vector<solution_t> weights;
+    if (args.size() >= 2) {
+        weights = loadResultsFile(args[1]);
+        std::erase_if(weights, [&startState](auto&& weight) {
+            return !std::ranges::contains(startState.targets, weight.first);
+            });
+    } else {
+        weights = startState.targets
+            | std::views::transform([](auto&& target) { return solution_t{ target, 1 }; })
+            | std::ranges::to<std::vector>();
+    }
+    buildEndgameTable(startState);
+    precomputeStrategy(startState);
+    // Solve the answers to fill in the strategy, then replay each game to
+    // count the weighted visits to each state.
+    auto& cache = strategyCache();
+    std::unordered_map<std::string, unsigned long long> visits;
+    unsigned long long totalVisits = 0;
+    for (auto&& [target, weight] : weights) {
+        solveWord(target, startState, false);
+        std::string key = startState.getKey();
+        for (;;) {
+            const word_t& guess = cache.at(key);
+            visits[key] += weight;
+            totalVisits += weight;
+            if (std::string_view(guess) == std::string_view(target)) {
+                break;
+            }
+            key.append(std::string_view(guess));
+            key.append(std::string_view(Hint::fromGuess(target, guess).getHint()));
+        }
+    }
+    // Write the most-visited states until the size limit is reached.
+    // Ties go to the shorter history so that a state is always written
+    // before the states that follow it.
+    using visitCount_t = std::pair<std::string, unsigned long long>;
+    auto states = visits | std::ranges::to<std::vector<visitCount_t>>();
+    std::ranges::sort(states, [](auto&& a, auto&& b) {
+        if (a.second != b.second)
+            return a.second > b.second;
+        if (a.first.size() != b.first.size())
+            return a.first.size() < b.first.size();
+        return a.first < b.first;
+        });
+    std::string header = std::format("wordler-strategy 1 {}\n",
+        getRulesName(rules));
+    std::string trailer = "?\n";
+    size_t size = header.size() + trailer.size();
+    if (size > CommandLine::GetMaxSize()) {
+        throwError("--max-size is too small");
+    }
+    std::ofstream outFile(filename, std::ios::out | std::ios::binary);
+    if (outFile.fail()) {
+        throwError(std::format("Failed to open file {}", filename).c_str());
     }
+    outFile << header;
+    unsigned numStates = 0;
+    unsigned long long coveredVisits = 0;
+    for (auto&& [key, count] : states) {
+        std::string line = std::format("{} {}\n",
+            std::string_view(cache.at(key)), key);
+        if (size + line.size() > CommandLine::GetMaxSize()) {
+            break;
+        }
+        outFile << line;
+        size += line.size();
+        ++numStates;
+        coveredVisits += count;
+    }
+    outFile << trailer;
+    if (outFile.fail()) {
+        throwError(std::format("Failed to write file {}", filename).c_str());
+    }
+    lvprintln("Exported {} of {} states ({} bytes)", numStates, states.size(), size);
+    lvprintln("Moves covered: {:.1f}%",
+        (totalVisits == 0) ? 0.0 : 100.0 * double(coveredVisits) / double(totalVisits));
 }
 
 // Test 1: Match words against a Hint.
@@ -731,6 +3428,7 @@ static void test1(auto args)
 }
 
 // Test 2: Output all target words that match the given hints.
+// Hints with wildcards are matched the same way as by makeGameState().
 // example args: raise .y..g grill y..y.
 static void test2(auto args)
 {
@@ -742,7 +3440,9 @@ static void test2(auto args)
         allTargets
         | std::views::filter([&hints](auto&& word) {
             return std::ranges::all_of(hints, [&word](auto&& hint) {
-                return hint.match(word);
+                return hint.hasWildcards()
+                    ? hint.couldBe(Hint::fromGuess(word, hint.getGuess()).getPattern())
+                    : hint.match(word);
                 });
             })
         | std::views::transform([](auto&& word) { return std::string_view(word); })
@@ -793,6 +3493,124 @@ static void test4(auto args)
     }
 }
 
+// Test 5: Send queries from stdin to a --query --shm server, and display the
+// replies and the mean round trip time.
+// example args: -t 5 wordler  (with the server run as: --query --shm=wordler)
+static void test5(auto args)
+{
+    if (args.size() != 1) {
+        throwError("Requires 1 arg");
+    }
+    ShmConnection channel = ShmConnection::open(args[0]);
+    std::string line;
+    unsigned count = 0;
+    double t = 0.0;
+    while (std::getline(std::cin, line)) {
+        std::string reply;
+        t += runTime([&]() {
+            channel->requests.push(line);
+            reply = channel->responses.pop([](std::string_view r) { return std::string(r); });
+            });
+        std::println("{}", reply);
+        ++count;
+    }
+    if (count > 0) {
+        std::println("Mean round trip: {:.2f} us", 1e6 * t / count);
+    }
+}
+
+// Test 6: Compare the round trip time of a shared memory channel with a TCP
+// connection on localhost, by sending messages to an echo thread.
+// Optional args are the number of round trips and the TCP port.
+// example args: -t 6 100000 5917
+static void test6(auto args)
+{
+    unsigned count = (args.size() >= 1) ? numFromStr(args[0]) : 100000;
+    unsigned port = (args.size() >= 2) ? numFromStr(args[1]) : 5917;
+    // Shared memory channel (in this process's memory, but the rings work the
+    // same way as between processes)
+    auto channel = std::make_unique<ShmChannel>();
+    std::jthread shmEcho([&]() {
+        for (unsigned i = 0; i < count; ++i) {
+            channel->requests.pop([&](std::string_view r) {
+                channel->responses.push(r);
+                return 0;
+                });
+        }
+        });
+    double tShm = runTime([&]() {
+        for (unsigned i = 0; i < count; ++i) {
+            channel->requests.push("0 raise y.gy.");
+            channel->responses.pop([](std::string_view r) { return r.size(); });
+        }
+        });
+    shmEcho.join();
+    // TCP connection
+    TcpSocket listener = TcpSocket::listen(uint16_t(port));
+    std::jthread tcpEcho([&]() {
+        std::optional<TcpSocket> conn = listener.accept(5000);
+        for (unsigned i = 0; conn && i < count; ++i) {
+            std::optional<std::string> line = conn->receiveLine(-1);
+            if (!line) {
+                break;
+            }
+            conn->sendLine(*line);
+        }
+        });
+    TcpSocket client = TcpSocket::connect("localhost", uint16_t(port));
+    double tTcp = runTime([&]() {
+        for (unsigned i = 0; i < count; ++i) {
+            client.sendLine("0 raise y.gy.");
+            client.receiveLine(-1);
+        }
+        });
+    std::println("Shared memory: {:.2f} us per round trip", 1e6 * tShm / count);
+    std::println("TCP: {:.2f} us per round trip", 1e6 * tTcp / count);
+}
+
+// Test 7: Score every guess word against every target word using the packed
+// pattern matrix, and by working out the patterns directly, with wordle
+// feedback. Check that the scores are the same and display the times and the
+// size of the matrix.
+// Optional arg is the number of targets to use (the first ones in allTargets).
+// example args: -t 7 1000
+static void test7(auto args)
+{
+    size_t numTargets = (args.size() >= 1)
+        ? std::min<size_t>(numFromStr(args[0]), std::size(allTargets))
+        : std::size(allTargets);
+    wordList_t targets{ std::from_range, allTargets | std::views::take(numTargets) };
+    std::vector<word_t> guessWords{ std::from_range, allTargets };
+    guessWords.append_range(allGuesses);
+    constexpr score_t maxScore = std::numeric_limits<score_t>::max();
+    std::vector<score_t> scoresDirect(guessWords.size());
+    std::vector<score_t> scoresPacked(guessWords.size());
+    double tBuild = runTime([]() { getPackedPatternMatrix<WordleFeedback>(); });
+    double tDirect = runTime([&]() {
+        for (auto&& [index, guess] : std::views::enumerate(guessWords)) {
+            scoresDirect[size_t(index)] =
+                *scoreGuess<WordleFeedback>(guess, size_t(index), targets, maxScore, 0);
+        }
+        });
+    std::vector<uint64_t> selected = *getTargetSelection(targets);
+    double tPacked = runTime([&]() {
+        for (auto&& [index, guess] : std::views::enumerate(guessWords)) {
+            scoresPacked[size_t(index)] = *scoreGuessPacked<WordleFeedback>(
+                *getPackedRowIndex(guess), selected, targets.size(), size_t(index), maxScore, 0);
+        }
+        });
+    size_t bytes = 0;
+    for (auto&& row : getPackedPatternMatrix<WordleFeedback>()) {
+        bytes += row.bytes();
+    }
+    std::println("Targets: {}", targets.size());
+    std::println("Scores match: {}", scoresDirect == scoresPacked);
+    std::println("Direct: {:.3f} seconds", tDirect);
+    std::println("Packed: {:.3f} seconds (plus {:.3f} to build)", tPacked, tBuild);
+    std::println("Packed matrix: {} bytes, {:.2f} per pattern", bytes,
+        double(bytes) / double(guessWords.size() * std::size(allTargets)));
+}
+
 // Run the test specified by the --test option.
 static void doTest(auto args)
 {
@@ -801,6 +3619,9 @@ static void doTest(auto args)
     case 2: test2(args); break;
     case 3: test3(args); break;
     case 4: test4(args); break;
+    case 5: test5(args); break;
+    case 6: test6(args); break;
+    case 7: test7(args); break;
     default: throwError("Invalid test number");
     }
 }
@@ -811,22 +3632,77 @@ int main(int argc, char* argv[])
         if (CommandLine::Parse(argc, argv)) {
             return 0;
         }
+        loadGuessRanking();
+        makeGuessShortlist();
         // Do whatever was commanded
         auto args = CommandLine::GetOtherArgs();
-        if (CommandLine::GetPlay()) {
-            doPlayGame(args);
-        } else if (CommandLine::GetSolve()) {
-            doSolve(args);
-        } else if (CommandLine::GetSolveAll()) {
-            doSolveAll(args);
-        } else if (CommandLine::GetShowStats()) {
-            doShowStats(args);
-        } else if (CommandLine::GetTest()) {
-            doTest(args);
+        if (!CommandLine::GetFeedback().empty()) {
+            // Another game's hints - the next guess, --solve and --all are
+            // supported, in normal mode. (The rest use the classic hints.)
+            if (CommandLine::GetPlay() || CommandLine::GetShowStats()
+                || CommandLine::GetExport() || CommandLine::GetTest()
+                || CommandLine::GetHardMode() || CommandLine::GetOfficial()
+                || CommandLine::GetConsistent()
+                || CommandLine::GetCoordinate() || !CommandLine::GetWorker().empty()
+                || CommandLine::GetRandom() || CommandLine::GetVerify()
+                || !CommandLine::GetCompare().empty() || CommandLine::GetQuery()
+                || CommandLine::GetImprove() || CommandLine::GetEndgame())
+            {
+                throwError("That option is not supported with --feedback");
+            }
+            withFeedback([&args]<class Feedback>() {
+                if (CommandLine::GetSolve()) {
+                    doSolve<GuessRules::Any, Feedback>(args);
+                } else if (CommandLine::GetSolveAll()) {
+                    doSolveAll<GuessRules::Any, Feedback>(args);
+                } else {
+                    doNextGuess<GuessRules::Any, Feedback>(args);
+                }
+                });
         } else {
-            // The default function is to process some hints and make a guess.
-            doNextGuess(args);
+            // Distributed --all (see doCoordinate())
+            if (CommandLine::GetCoordinate() && !CommandLine::GetSolveAll()) {
+                throwError("--coordinate requires --all");
+            }
+            if ((CommandLine::GetCoordinate() || !CommandLine::GetWorker().empty())
+                && CommandLine::GetImprove())
+            {
+                throwError("--improve is not supported with --coordinate or --worker");
+            }
+            withGuessRules([&args]<GuessRules rules>() {
+                if (CommandLine::GetPlay()) {
+                    doPlayGame<rules>(args);
+                } else if (CommandLine::GetQuery()) {
+                    doQuery<rules>();
+                } else if (CommandLine::GetSolve()) {
+                    doSolve<rules>(args);
+                } else if (CommandLine::GetSolveAll()) {
+                    if (CommandLine::GetCoordinate()) {
+                        doCoordinate<rules>();
+                    } else {
+                        doSolveAll<rules>(args);
+                    }
+                } else if (!CommandLine::GetWorker().empty()) {
+                    doWorker<rules>();
+                } else if (CommandLine::GetShowStats()) {
+                    doShowStats(args);
+                } else if (CommandLine::GetRandom()) {
+                    doRandomPlayer();
+                } else if (CommandLine::GetVerify()) {
+                    doVerifyShortlist<rules>();
+                } else if (!CommandLine::GetCompare().empty()) {
+                    doCompare<rules>();
+                } else if (CommandLine::GetExport()) {
+                    doExport<rules>(args);
+                } else if (CommandLine::GetTest()) {
+                    doTest(args);
+                } else {
+                    // The default function is to process some hints and make a guess.
+                    doNextGuess<rules>(args);
+                }
+                });
         }
+        saveGuessRanking();
     } catch (const std::exception& e) {
         std::println("{}: Error: {}", CommandLine::GetProgName(), e.what());
         return 1;
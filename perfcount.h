@@ -0,0 +1,137 @@
+// Copyright (c) Len Popp
+// This source code is licensed under the MIT license - see LICENSE file.
+
+#pragma once
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware event counts measured by countEvents().
+// A count is empty if that counter isn't available, e.g. on systems other
+// than Linux, or if perf events are not permitted.
+// The counts include the threads started while counting, but not threads
+// that were already running, e.g. a thread pool started earlier.
+struct PerfCounts
+{
+    std::optional<uint64_t> cycles;
+    std::optional<uint64_t> instructions;
+    std::optional<uint64_t> cacheMisses;
+    std::optional<uint64_t> branchMisses;
+    // The hardware was shared with other counters for part of the time, so
+    // the counts are estimates scaled up from the time they were counted.
+    bool fScaled = false;
+};
+
+// A hardware event counter for the current thread and the threads it starts.
+// Counters can be put in a group with a leader, so that they're always
+// counted at the same time. The leader starts and stops the whole group.
+class PerfCounter
+{
+private:
+    int fd = -1;
+
+public:
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    explicit PerfCounter([[maybe_unused]] uint64_t config,
+        [[maybe_unused]] const PerfCounter* leader = nullptr)
+    {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int groupFd = leader ? leader->fd : -1;
+        fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+#endif
+    }
+
+    ~PerfCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    // Reset and start the counter and its group.
+    void start()
+    {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    // Stop the counter and its group.
+    void stop()
+    {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    // Return the count, scaled up if the counter only ran for part of the
+    // time it was enabled, in which case fScaled is set.
+    std::optional<uint64_t> read([[maybe_unused]] bool& fScaled) const
+    {
+#ifdef __linux__
+        // value, time enabled, time running
+        std::array<uint64_t, 3> data{};
+        if (fd >= 0 && ::read(fd, data.data(), sizeof(data)) == sizeof(data)) {
+            auto [count, enabled, running] = data;
+            if (running == 0) {
+                return std::nullopt;
+            }
+            if (running < enabled) {
+                fScaled = true;
+                return uint64_t(double(count) * double(enabled) / double(running));
+            }
+            return count;
+        }
+#endif
+        return std::nullopt;
+    }
+};
+
+// Run a function and count the hardware events that happen while it runs.
+PerfCounts countEvents(std::invocable auto func)
+{
+#ifdef __linux__
+    PerfCounter cycles(PERF_COUNT_HW_CPU_CYCLES);
+    PerfCounter instructions(PERF_COUNT_HW_INSTRUCTIONS, &cycles);
+    PerfCounter cacheMisses(PERF_COUNT_HW_CACHE_MISSES, &cycles);
+    PerfCounter branchMisses(PERF_COUNT_HW_BRANCH_MISSES, &cycles);
+    cycles.start();
+    func();
+    cycles.stop();
+    PerfCounts counts;
+    counts.cycles = cycles.read(counts.fScaled);
+    counts.instructions = instructions.read(counts.fScaled);
+    counts.cacheMisses = cacheMisses.read(counts.fScaled);
+    counts.branchMisses = branchMisses.read(counts.fScaled);
+    return counts;
+#else
+    func();
+    return PerfCounts{};
+#endif
+}
@@ -0,0 +1,96 @@
+// Copyright (c) Len Popp
+// This source code is licensed under the MIT license - see LICENSE file.
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// A fixed-size set of bits that can quickly count the bits that are set
+// before a position (rank) and find the n'th bit that is set (select), e.g.
+// to pick a random member of a set without making a list of the members.
+// Call buildIndex() after changing the bits, before calling count(), rank()
+// or select().
+template<size_t size_>
+class RankSelectBits
+{
+private:
+    static constexpr size_t numWords = (size_ + 63) / 64;
+
+    std::array<uint64_t, numWords> words{};
+    // ranks[i] is the number of bits set in words[0] to words[i-1]
+    std::array<uint32_t, numWords + 1> ranks{};
+
+public:
+    static constexpr size_t size()
+    {
+        return size_;
+    }
+
+    bool test(size_t i) const
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    void set(size_t i)
+    {
+        words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    void reset(size_t i)
+    {
+        words[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+
+    // Clear the bits whose positions don't satisfy a predicate.
+    // This also rebuilds the index.
+    void keepIf(auto pred)
+    {
+        for (size_t w = 0; w < numWords; ++w) {
+            for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+                size_t i = w * 64 + size_t(std::countr_zero(bits));
+                if (!pred(i)) {
+                    reset(i);
+                }
+            }
+        }
+        buildIndex();
+    }
+
+    void buildIndex()
+    {
+        for (size_t w = 0; w < numWords; ++w) {
+            ranks[w + 1] = ranks[w] + uint32_t(std::popcount(words[w]));
+        }
+    }
+
+    // Return the number of bits set.
+    size_t count() const
+    {
+        return ranks[numWords];
+    }
+
+    // Return the number of bits set before position i.
+    size_t rank(size_t i) const
+    {
+        if (i % 64 == 0) {
+            return ranks[i / 64];
+        }
+        return ranks[i / 64]
+            + size_t(std::popcount(words[i / 64] & ((uint64_t(1) << (i % 64)) - 1)));
+    }
+
+    // Return the position of the n'th bit set, counting from 0.
+    // n must be less than count().
+    size_t select(size_t n) const
+    {
+        // Find the word containing the bit, then the bit in the word.
+        size_t w = size_t(std::ranges::upper_bound(ranks, uint32_t(n)) - ranks.begin()) - 1;
+        uint64_t bits = words[w];
+        for (size_t k = n - ranks[w]; k > 0; --k) {
+            bits &= bits - 1;
+        }
+        return w * 64 + size_t(std::countr_zero(bits));
+    }
+};
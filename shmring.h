@@ -0,0 +1,305 @@
+// Copyright (c) Len Popp
+// This source code is licensed under the MIT license - see LICENSE file.
+
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Wait until the value at addr is no longer expected, or until woken by
+// futexWake(). May return early. Works between processes.
+// (Not a std::atomic::wait() because that isn't guaranteed to work between
+// processes.)
+inline void futexWait([[maybe_unused]] std::atomic<uint32_t>& word,
+    [[maybe_unused]] uint32_t expected)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected,
+        nullptr, nullptr, 0);
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Wake up whatever is waiting in futexWait() on the given word.
+inline void futexWake([[maybe_unused]] std::atomic<uint32_t>& word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1,
+        nullptr, nullptr, 0);
+#endif
+}
+
+// A message in a ring: a line of text
+struct ShmMessage
+{
+    static constexpr size_t maxSize = 252;
+
+    uint32_t size;
+    char text[maxSize];
+};
+
+// A lock-free ring of messages with a single producer and a single consumer,
+// which can be in different processes if the ring is in shared memory.
+// Messages are written and read in place. The consumer spins for a while when
+// the ring is empty, then sleeps on a futex. The producer only makes a system
+// call to wake the consumer if it's asleep.
+template<uint32_t capacity>
+struct SpscRing
+{
+    static_assert(std::has_single_bit(capacity), "capacity must be a power of 2");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+    // Number of times to check an empty ring before sleeping
+    static constexpr unsigned spinCount = 4000;
+
+    alignas(64) std::atomic<uint32_t> head{ 0 };    // next message to read
+    alignas(64) std::atomic<uint32_t> tail{ 0 };    // next message to write
+    std::atomic<uint32_t> sleeping{ 0 };            // consumer is asleep
+    ShmMessage messages[capacity];
+
+    // Add a message to the ring, waiting if it's full.
+    void push(std::string_view text)
+    {
+        if (text.size() > ShmMessage::maxSize) {
+            throw std::runtime_error(std::format("Message is too long ({} chars)", text.size()));
+        }
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        while (t - head.load(std::memory_order_acquire) == capacity) {
+            std::this_thread::yield();
+        }
+        ShmMessage& message = messages[t % capacity];
+        message.size = uint32_t(text.size());
+        std::memcpy(message.text, text.data(), text.size());
+        tail.store(t + 1, std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_seq_cst)) {
+            futexWake(tail);
+        }
+    }
+
+    // Wait for a message, then call func with it (as a string_view that is
+    // only valid during the call) and remove it from the ring.
+    // Return whatever func returns.
+    auto pop(auto func)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        unsigned spins = 0;
+        for (;;) {
+            uint32_t t = tail.load(std::memory_order_acquire);
+            if (t != h) {
+                break;
+            }
+            if (++spins < spinCount) {
+                continue;
+            }
+            // Sleep until the producer changes tail. (Setting sleeping before
+            // checking tail again means the producer can't miss it.)
+            sleeping.store(1, std::memory_order_seq_cst);
+            if (tail.load(std::memory_order_seq_cst) == h) {
+                futexWait(tail, h);
+            }
+            sleeping.store(0, std::memory_order_relaxed);
+        }
+        const ShmMessage& message = messages[h % capacity];
+        auto result = func(std::string_view(message.text, message.size));
+        head.store(h + 1, std::memory_order_release);
+        return result;
+    }
+};
+
+// A request/response channel between a server and one client at a time
+struct ShmChannel
+{
+    SpscRing<16> requests;
+    SpscRing<16> responses;
+};
+
+// A ShmChannel in a named shared memory object (Linux only).
+// The server creates it and the client opens it. The server keeps the object
+// locked (with flock()) while it runs, so that another server can tell
+// whether an object with the same name is in use or was left behind.
+class ShmConnection
+{
+private:
+    ShmChannel* channel = nullptr;
+    std::string name;
+    bool fOwner = false;
+#ifdef __linux__
+    // The server's object, kept open to hold the lock
+    int fd = -1;
+    dev_t dev = 0;
+    ino_t ino = 0;
+#endif
+
+    [[noreturn]] static void throwShmError(std::string_view what)
+    {
+        throw std::runtime_error(std::format("Shared memory error: {}", what));
+    }
+
+#ifdef __linux__
+    // Return whether the name refers to the object with the given status,
+    // i.e. it hasn't been removed or replaced.
+    bool isNamed(const struct stat& st) const
+    {
+        int nameFd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (nameFd < 0) {
+            return false;
+        }
+        struct stat nameSt;
+        bool fSame = fstat(nameFd, &nameSt) == 0
+            && nameSt.st_dev == st.st_dev && nameSt.st_ino == st.st_ino;
+        close(nameFd);
+        return fSame;
+    }
+
+    // Create the object and lock it. An object with the same name that
+    // isn't locked was left behind by a server that didn't exit cleanly, and
+    // is replaced. One that is locked belongs to a server that's still
+    // running, so it's an error.
+    void createLocked()
+    {
+        // (Another server starting at the same time can take the name
+        // between steps, so try again a few times.)
+        for (int tries = 0; tries < 10; ++tries) {
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd >= 0) {
+                struct stat st;
+                if (flock(fd, LOCK_EX | LOCK_NB) == 0 && fstat(fd, &st) == 0 && isNamed(st)) {
+                    dev = st.st_dev;
+                    ino = st.st_ino;
+                    return;
+                }
+                close(fd);
+                fd = -1;
+                continue;
+            }
+            if (errno != EEXIST) {
+                break;
+            }
+            int oldFd = shm_open(name.c_str(), O_RDWR, 0);
+            if (oldFd < 0) {
+                // (It was removed in the meantime.)
+                continue;
+            }
+            if (flock(oldFd, LOCK_EX | LOCK_NB) != 0) {
+                close(oldFd);
+                throwShmError(std::format("{} is in use by another server", name));
+            }
+            struct stat oldSt;
+            if (fstat(oldFd, &oldSt) == 0 && isNamed(oldSt)) {
+                shm_unlink(name.c_str());
+            }
+            close(oldFd);
+        }
+        throwShmError(std::format("can't create {}", name));
+    }
+
+    // Remove the name if it's still this server's object, and release it.
+    void removeOwned()
+    {
+        struct stat st{};
+        st.st_dev = dev;
+        st.st_ino = ino;
+        if (isNamed(st)) {
+            shm_unlink(name.c_str());
+        }
+        close(fd);
+        fd = -1;
+    }
+#endif
+
+    ShmConnection(std::string_view nameIn, [[maybe_unused]] bool fCreate)
+        : name(std::format("/{}", nameIn)), fOwner(fCreate)
+    {
+#ifdef __linux__
+        int mapFd = -1;
+        if (fCreate) {
+            createLocked();
+            mapFd = fd;
+            if (ftruncate(mapFd, sizeof(ShmChannel)) != 0) {
+                removeOwned();
+                throwShmError("can't set the size");
+            }
+        } else {
+            mapFd = shm_open(name.c_str(), O_RDWR, 0);
+            if (mapFd < 0) {
+                throwShmError(std::format("can't open {}", name));
+            }
+            // (The server may not have set the size yet.)
+            struct stat st;
+            if (fstat(mapFd, &st) != 0 || size_t(st.st_size) < sizeof(ShmChannel)) {
+                close(mapFd);
+                throwShmError(std::format("{} isn't ready", name));
+            }
+        }
+        void* addr = mmap(nullptr, sizeof(ShmChannel), PROT_READ | PROT_WRITE, MAP_SHARED, mapFd, 0);
+        if (!fCreate) {
+            close(mapFd);
+        }
+        if (addr == MAP_FAILED) {
+            if (fCreate) {
+                removeOwned();
+            }
+            throwShmError("can't map");
+        }
+        channel = fCreate ? new (addr) ShmChannel : static_cast<ShmChannel*>(addr);
+#else
+        throwShmError("only supported on Linux");
+#endif
+    }
+
+public:
+    ShmConnection(const ShmConnection&) = delete;
+    ShmConnection& operator=(const ShmConnection&) = delete;
+
+    ~ShmConnection()
+    {
+#ifdef __linux__
+        munmap(channel, sizeof(ShmChannel));
+        if (fOwner) {
+            removeOwned();
+        }
+#endif
+    }
+
+    // Create a new channel with the given name, for a server, replacing a
+    // channel with the same name that was left behind.
+    static ShmConnection create(std::string_view name)
+    {
+        return ShmConnection(name, true);
+    }
+
+    // Open an existing channel with the given name, for a client.
+    static ShmConnection open(std::string_view name)
+    {
+        return ShmConnection(name, false);
+    }
+
+    ShmChannel& operator*() const
+    {
+        return *channel;
+    }
+
+    ShmChannel* operator->() const
+    {
+        return channel;
+    }
+};
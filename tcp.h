@@ -0,0 +1,218 @@
+// Copyright (c) Len Popp
+// This source code is licensed under the MIT license - see LICENSE file.
+
+#pragma once
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// A TCP connection or listening socket that sends and receives lines of text.
+// Errors throw std::runtime_error, except that a lost connection is reported
+// by receiveLine() so the caller can recover from it.
+class TcpSocket
+{
+private:
+#ifdef _WIN32
+    using socket_t = SOCKET;
+    static constexpr socket_t noSocket = INVALID_SOCKET;
+#else
+    using socket_t = int;
+    static constexpr socket_t noSocket = -1;
+#endif
+
+    socket_t sock = noSocket;
+    std::string received;   // data received but not yet returned as a line
+
+    explicit TcpSocket(socket_t sockIn) : sock(sockIn) {}
+
+    [[noreturn]] static void throwSocketError(std::string_view what)
+    {
+        throw std::runtime_error(std::format("Network error: {}", what));
+    }
+
+    // Initialize the socket library, once. (Only needed on Windows.)
+    static void startup()
+    {
+#ifdef _WIN32
+        static bool fStarted = []() {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+            }();
+        if (!fStarted) {
+            throwSocketError("WSAStartup failed");
+        }
+#endif
+    }
+
+    // Wait until the socket is readable. Return false if the timeout (in
+    // milliseconds, or -1 to wait forever) expires first.
+    bool wait(int timeoutMs) const
+    {
+        pollfd pfd{};
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+#ifdef _WIN32
+        return WSAPoll(&pfd, 1, timeoutMs) > 0;
+#else
+        return poll(&pfd, 1, timeoutMs) > 0;
+#endif
+    }
+
+public:
+    TcpSocket() = default;
+    TcpSocket(const TcpSocket&) = delete;
+    TcpSocket& operator=(const TcpSocket&) = delete;
+
+    TcpSocket(TcpSocket&& other) noexcept
+        : sock(std::exchange(other.sock, noSocket)),
+        received(std::move(other.received))
+    {
+    }
+
+    TcpSocket& operator=(TcpSocket&& other) noexcept
+    {
+        std::swap(sock, other.sock);
+        std::swap(received, other.received);
+        return *this;
+    }
+
+    ~TcpSocket()
+    {
+        if (sock != noSocket) {
+#ifdef _WIN32
+            closesocket(sock);
+#else
+            close(sock);
+#endif
+        }
+    }
+
+    // Return a socket listening for connections on the given port.
+    static TcpSocket listen(uint16_t port)
+    {
+        startup();
+        TcpSocket listener(socket(AF_INET, SOCK_STREAM, 0));
+        if (listener.sock == noSocket) {
+            throwSocketError("can't create socket");
+        }
+        int on = 1;
+        setsockopt(listener.sock, SOL_SOCKET, SO_REUSEADDR,
+            reinterpret_cast<const char*>(&on), sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(listener.sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0
+            || ::listen(listener.sock, SOMAXCONN) != 0)
+        {
+            throwSocketError(std::format("can't listen on port {}", port));
+        }
+        return listener;
+    }
+
+    // Wait for a connection to a listening socket, for up to timeoutMs
+    // milliseconds. Return the connection, or nothing if the time ran out.
+    std::optional<TcpSocket> accept(int timeoutMs)
+    {
+        if (!wait(timeoutMs)) {
+            return std::nullopt;
+        }
+        TcpSocket conn(::accept(sock, nullptr, nullptr));
+        if (conn.sock == noSocket) {
+            return std::nullopt;
+        }
+        return conn;
+    }
+
+    // Return a connection to the given host and port.
+    static TcpSocket connect(const std::string& host, uint16_t port)
+    {
+        startup();
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addrs = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addrs) != 0) {
+            throwSocketError(std::format("unknown host {}", host));
+        }
+        TcpSocket conn;
+        for (addrinfo* addr = addrs; addr; addr = addr->ai_next) {
+            TcpSocket attempt(socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol));
+            if (attempt.sock != noSocket
+                && ::connect(attempt.sock, addr->ai_addr, int(addr->ai_addrlen)) == 0)
+            {
+                conn = std::move(attempt);
+                break;
+            }
+        }
+        freeaddrinfo(addrs);
+        if (conn.sock == noSocket) {
+            throwSocketError(std::format("can't connect to {}:{}", host, port));
+        }
+        return conn;
+    }
+
+    // Send a line of text. A newline is added.
+    void sendLine(std::string_view line)
+    {
+        std::string data = std::format("{}\n", line);
+#ifdef MSG_NOSIGNAL
+        constexpr int flags = MSG_NOSIGNAL;
+#else
+        constexpr int flags = 0;
+#endif
+        for (size_t sent = 0; sent < data.size(); ) {
+            auto n = send(sock, data.data() + sent, int(data.size() - sent), flags);
+            if (n <= 0) {
+                throwSocketError("connection lost");
+            }
+            sent += size_t(n);
+        }
+    }
+
+    // Receive a line of text, without the newline. Wait for up to timeoutMs
+    // milliseconds (or forever if -1) for each part of the line.
+    // Return nothing if the time ran out or the connection was lost.
+    std::optional<std::string> receiveLine(int timeoutMs)
+    {
+        for (;;) {
+            size_t end = received.find('\n');
+            if (end != std::string::npos) {
+                std::string line = received.substr(0, end);
+                received.erase(0, end + 1);
+                if (line.ends_with('\r')) {
+                    line.pop_back();
+                }
+                return line;
+            }
+            if (!wait(timeoutMs)) {
+                return std::nullopt;
+            }
+            char buf[1024];
+            auto n = recv(sock, buf, int(sizeof(buf)), 0);
+            if (n <= 0) {
+                return std::nullopt;
+            }
+            received.append(buf, size_t(n));
+        }
+    }
+};